@@ -0,0 +1,258 @@
+// vc_bench: measures vc's own overhead on synthetic projects.
+//
+// Microbenchmarks time the .libpath and cproject.toml helpers directly;
+// end-to-end cases time the vc binary for list, install (against local
+// pkg-config stand-ins) and an up-to-date run. Results are written as JSON.
+#include "virtualc_common.h"
+#include <chrono>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifndef VC_BENCH_VC_PATH
+#define VC_BENCH_VC_PATH "vc"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    std::string name;
+    size_t packages;
+    std::vector<double> samples_ns;
+};
+
+// Utility: summary statistics of the samples, in nanoseconds
+struct Stats {
+    double min = 0, median = 0, mean = 0;
+};
+
+Stats summarize(std::vector<double> samples) {
+    Stats stats;
+    if (samples.empty()) return stats;
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples.front();
+    stats.median = samples[samples.size() / 2];
+    double total = 0;
+    for (double s : samples) total += s;
+    stats.mean = total / samples.size();
+    return stats;
+}
+
+// Time fn `iterations` times; setup runs before each sample and is not timed
+BenchResult measure(const std::string& name, size_t packages, size_t iterations,
+                    const std::function<void()>& fn, const std::function<void()>& setup = nullptr) {
+    BenchResult result{name, packages, {}};
+    for (size_t i = 0; i < iterations; ++i) {
+        if (setup) setup();
+        auto start = Clock::now();
+        fn();
+        result.samples_ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    std::cerr << "  " << name << " [" << packages << "]: "
+              << summarize(result.samples_ns).median / 1000.0 << " us" << std::endl;
+    return result;
+}
+
+// Synthetic project with n header-only packages that all point at one include dir
+struct SyntheticProject {
+    fs::path root;
+    fs::path libpath;
+    fs::path tomlfile;
+    fs::path pc_dir;
+    std::string libpath_content;
+    std::string toml_content;
+};
+
+SyntheticProject make_project(const fs::path& base, size_t n) {
+    SyntheticProject project;
+    project.root = base / ("project_" + std::to_string(n));
+    project.libpath = project.root / ".libpath";
+    project.tomlfile = project.root / "cproject.toml";
+    project.pc_dir = project.root / "pkgconfig";
+    fs::path include_dir = project.root / "include";
+    fs::create_directories(project.root / ".venv");
+    fs::create_directories(include_dir);
+    fs::create_directories(project.pc_dir);
+
+    std::ostringstream libpath;
+    std::ostringstream deps;
+    for (size_t i = 0; i < n; ++i) {
+        std::string pkg = "benchpkg" + std::to_string(i);
+        libpath << "[" << pkg << "]\n"
+                << "version = \"1.0." << i << "\"\n"
+                << "includes = [\"" << include_dir.string() << "\"]\n"
+                << "libnames = []\n"
+                << "libpaths = []\n\n";
+        deps << (i ? ", " : "") << "\"" << pkg << "==1.0." << i << "\"";
+    }
+    project.libpath_content = libpath.str();
+    project.toml_content = "[project]\ncompilerpath = \"\"\ndependencies = [" + deps.str() + "]\n";
+
+    create_file(project.libpath, project.libpath_content);
+    create_file(project.tomlfile, project.toml_content);
+    create_file(project.root / ".ignorepath", IGNOREPATH_CONTENT);
+    create_file(project.root / "main.c", "int main(void) { return 0; }\n");
+    return project;
+}
+
+// Write a pkg-config stand-in so vc install resolves without a script
+void write_pc_file(const SyntheticProject& project, const std::string& pkg) {
+    create_file(project.pc_dir / (pkg + ".pc"),
+                "prefix=" + project.root.string() + "\n"
+                "Name: " + pkg + "\n"
+                "Description: vc_bench stand-in\n"
+                "Version: 1.0.0\n"
+                "Cflags: -I${prefix}/include\n");
+}
+
+// Run the vc binary in dir with output discarded; returns its exit status
+int run_vc(const std::string& vc, const fs::path& dir, const std::vector<std::string>& args, const fs::path& pc_dir) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(dir.c_str()) != 0) _exit(127);
+        int devnull = open("/dev/null", O_RDWR);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+        setenv("PKG_CONFIG_PATH", pc_dir.c_str(), 1);
+        std::vector<char*> argv{const_cast<char*>(vc.c_str())};
+        for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        execvp(vc.c_str(), argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Record an end-to-end case only if every invocation succeeded: the latency of a
+// failing command hides the regression that made it fail
+bool record_e2e(std::vector<BenchResult>& results, BenchResult result, bool ok) {
+    if (!ok) {
+        std::cerr << "  " << result.name << " failed for " << result.packages << " packages; not recorded" << std::endl;
+        return false;
+    }
+    results.push_back(std::move(result));
+    return true;
+}
+
+void write_json(const fs::path& out, const std::vector<BenchResult>& results) {
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"vc_bench\",\n  \"unit\": \"ns\",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        Stats stats = summarize(results[i].samples_ns);
+        json << (i ? "," : "") << "\n    {\"name\": \"" << json_escape(results[i].name) << "\""
+             << ", \"packages\": " << results[i].packages
+             << ", \"iterations\": " << results[i].samples_ns.size()
+             << ", \"min_ns\": " << static_cast<long long>(stats.min)
+             << ", \"median_ns\": " << static_cast<long long>(stats.median)
+             << ", \"mean_ns\": " << static_cast<long long>(stats.mean) << "}";
+    }
+    json << "\n  ]\n}\n";
+    write_file_atomic(out, json.str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("vc_bench", "Benchmark vc's parsers and command latency");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("o,output", "JSON results file", cxxopts::value<std::string>()->default_value("vc_bench.json"))
+        ("sizes", "Package counts to generate", cxxopts::value<std::vector<int>>()->default_value("10,100,1000,10000"))
+        ("vc", "vc binary for end-to-end cases", cxxopts::value<std::string>()->default_value(VC_BENCH_VC_PATH))
+        ("no-e2e", "Skip the end-to-end vc invocations");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::string vc = result["vc"].as<std::string>();
+    bool e2e = !result.count("no-e2e");
+    fs::path base = fs::temp_directory_path() / ("vc_bench_" + std::to_string(getpid()));
+    std::vector<BenchResult> results;
+    bool all_ok = true;
+
+    for (int size : result["sizes"].as<std::vector<int>>()) {
+        if (size <= 0) continue;
+        size_t n = static_cast<size_t>(size);
+        // Keep each case around a fixed amount of work regardless of size
+        size_t iterations = std::clamp<size_t>(20000 / n, 5, 200);
+        SyntheticProject project = make_project(base, n);
+        std::string last = "benchpkg" + std::to_string(n - 1);
+        std::string middle = "benchpkg" + std::to_string(n / 2);
+        std::cerr << "Packages: " << n << std::endl;
+
+        results.push_back(measure("build_compiler_args", n, iterations, [&]() {
+            build_compiler_args(project.libpath);
+        }));
+        results.push_back(measure("is_package_installed.last", n, iterations, [&]() {
+            is_package_installed(project.libpath, last);
+        }));
+        results.push_back(measure("is_package_installed.missing", n, iterations, [&]() {
+            is_package_installed(project.libpath, "benchpkg_missing");
+        }));
+        results.push_back(measure("get_dependencies", n, iterations, [&]() {
+            get_dependencies(project.tomlfile);
+        }));
+        results.push_back(measure("remove_package_from_libpath", n, iterations, [&]() {
+            remove_package_from_libpath(project.libpath, middle);
+        }, [&]() {
+            write_file_atomic(project.libpath, project.libpath_content);
+        }));
+        results.push_back(measure("add_dependency_toml", n, iterations, [&]() {
+            add_dependency_toml(project.tomlfile, "benchpkg_new", "2.0.0");
+        }, [&]() {
+            write_file_atomic(project.tomlfile, project.toml_content);
+        }));
+        write_file_atomic(project.libpath, project.libpath_content);
+        write_file_atomic(project.tomlfile, project.toml_content);
+
+        if (!e2e) continue;
+        size_t e2e_iterations = std::clamp<size_t>(2000 / n, 3, 20);
+
+        bool ok = true;
+        BenchResult list = measure("vc_list", n, e2e_iterations, [&]() {
+            ok = run_vc(vc, project.root, {"list"}, project.pc_dir) == 0 && ok;
+        });
+        all_ok = record_e2e(results, list, ok) && all_ok;
+
+        // Every sample installs a fresh stand-in so none hits the already-installed path
+        size_t install_index = 0;
+        ok = true;
+        BenchResult install = measure("vc_install.pkg-config", n, e2e_iterations, [&]() {
+            ok = run_vc(vc, project.root, {"install", "benchinstall" + std::to_string(install_index++)}, project.pc_dir) == 0 && ok;
+        }, [&]() {
+            write_pc_file(project, "benchinstall" + std::to_string(install_index));
+        });
+        all_ok = record_e2e(results, install, ok) && all_ok;
+        write_file_atomic(project.libpath, project.libpath_content);
+        write_file_atomic(project.tomlfile, project.toml_content);
+
+        // The first run compiles; the samples measure the up-to-date path
+        if (run_vc(vc, project.root, {"run", "main.c", "--no-exec"}, project.pc_dir) != 0) {
+            std::cerr << "  vc run failed for " << n << " packages; skipping run latency" << std::endl;
+            all_ok = false;
+            continue;
+        }
+        ok = true;
+        BenchResult run = measure("vc_run.up_to_date", n, e2e_iterations, [&]() {
+            ok = run_vc(vc, project.root, {"run", "main.c", "--no-exec"}, project.pc_dir) == 0 && ok;
+        });
+        all_ok = record_e2e(results, run, ok) && all_ok;
+    }
+
+    write_json(result["output"].as<std::string>(), results);
+    std::error_code ec;
+    fs::remove_all(base, ec);
+    std::cerr << "Wrote " << result["output"].as<std::string>() << std::endl;
+    // Failed cases are left out of the results, so a CI run must not pass silently
+    return all_ok ? 0 : 1;
+}
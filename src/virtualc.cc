@@ -6,6 +6,37 @@
 #include "virtualc_run.h"
 #include "virtualc_upgrade.h"
 #include "virtualc_clear.h"
+#include "virtualc_generate.h"
+#include "virtualc_env.h"
+#include "virtualc_sync.h"
+#include "virtualc_verify.h"
+#include "virtualc_pack.h"
+#include "virtualc_dedupe.h"
+#include "virtualc_index.h"
+#include "virtualc_worker.h"
+#include "virtualc_workspace.h"
+
+// Remove --format=<text|json> (or --format <fmt>) before any "--" from args;
+// returns true for json
+static bool take_json_format(std::vector<char*>& args) {
+    std::string format = "text";
+    for (size_t i = 0; i < args.size(); ++i) {
+        std::string arg = args[i];
+        if (arg == "--") break;
+        if (arg.rfind("--format=", 0) == 0) {
+            format = arg.substr(9);
+            args.erase(args.begin() + i--);
+        } else if (arg == "--format" && i + 1 < args.size()) {
+            format = args[i + 1];
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            i--;
+        }
+    }
+    if (format != "text" && format != "json") {
+        throw std::runtime_error("Unknown output format '" + format + "' (expected text or json)");
+    }
+    return format == "json";
+}
 
 int main(int argc, char** argv) {
     try {
@@ -16,6 +47,17 @@ int main(int argc, char** argv) {
 
         std::string command = argv[1];
 
+        // list, install and run can report a JSON document on stdout instead of text
+        std::vector<char*> args(argv, argv + argc);
+        bool json = false;
+        if (command == "list" || command == "install" || command == "run") {
+            json = take_json_format(args);
+            argc = static_cast<int>(args.size());
+            args.push_back(nullptr);
+            argv = args.data();
+            if (json) enable_json_output();
+        }
+
         if (command == "init") {
             // Adjust argc/argv to omit the subcommand
             return init_main(argc - 1, argv + 1);
@@ -29,7 +71,7 @@ int main(int argc, char** argv) {
             for (int i = 2; i < argc; i++) {
                 packages.push_back(argv[i]);
             }
-            return install_main(packages);
+            return install_main(packages, json);
         } else if (command == "uninstall") {
             if (argc < 3) {
                 std::cerr << "Error: No package specified for uninstallation" << std::endl;
@@ -42,7 +84,7 @@ int main(int argc, char** argv) {
             }
             return uninstall_main(packages);
         } else if (command == "list") {
-            return list_packages_main();
+            return list_packages_main(json);
         } else if (command == "run") {
             if (argc < 3) {
                 std::cerr << "Error: No filename specified to run" << std::endl;
@@ -51,8 +93,30 @@ int main(int argc, char** argv) {
             return run_main(argc - 2, argv + 2);
         } else if (command == "upgrade") {
             return upgrade_libs_main();
+        } else if (command == "search") {
+            return search_main(argc - 1, argv + 1);
         } else if (command == "clear") {
             return clear_main();
+        } else if (command == "generate") {
+            return generate_main(argc - 1, argv + 1);
+        } else if (command == "env") {
+            return env_main(argc - 1, argv + 1);
+        } else if (command == "shell") {
+            return shell_main(argc - 1, argv + 1);
+        } else if (command == "sync") {
+            return sync_main(argc - 1, argv + 1);
+        } else if (command == "verify") {
+            return verify_main(argc - 1, argv + 1);
+        } else if (command == "pack") {
+            return pack_main(argc - 1, argv + 1);
+        } else if (command == "unpack") {
+            return unpack_main(argc - 1, argv + 1);
+        } else if (command == "dedupe") {
+            return dedupe_main(argc - 1, argv + 1);
+        } else if (command == "worker") {
+            return worker_main(argc - 1, argv + 1);
+        } else if (command == "workspace") {
+            return workspace_main(argc - 1, argv + 1);
         } else if (command == "--help" || command == "-h") {
             print_help();
             return 0;
@@ -12,6 +12,7 @@ int clear_main() {
         cwd / ".libpath",
         cwd / ".verified",
         cwd / "cproject.toml",
+        cwd / "cproject.lock",
         cwd / "README.md"
     };
     
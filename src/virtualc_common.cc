@@ -1,4 +1,13 @@
 #include "virtualc_common.h"
+#include <atomic>
+#include <cerrno>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 const char* GITIGNORE_CONTENT = R"(# Build artifacts
 *.o
@@ -60,6 +69,9 @@ out/
 Thumbs.db
 
 # virtualc
+compile_commands.json
+build.ninja
+.ninja_*
 .libpath
 .verified
 .venv
@@ -88,41 +100,76 @@ void create_file(const fs::path& path, const std::string& content) {
     ofs << content;
 }
 
-// Function to find the path to GCC using 'which' command
-std::string find_gcc_path() {
-    std::string gcc_path = "";
-    FILE* pipe = popen("which gcc 2>/dev/null", "r");
-    if (!pipe) return gcc_path;
-    
-    char buffer[256];
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        gcc_path = std::string(buffer);
-        // Remove trailing newline if present
-        if (!gcc_path.empty() && gcc_path.back() == '\n') {
-            gcc_path.pop_back();
+// Utility: read a whole file into a string
+std::string read_file(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// Utility: write a file by writing a temporary sibling and renaming it over the target,
+// so readers see either the old or the new content and a crash never leaves a partial file
+void write_file_atomic(const fs::path& path, const std::string& content) {
+    static std::atomic<unsigned> counter{0};
+    fs::path tmp = path;
+    tmp += ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter++);
+
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create file: " + path.string());
+    }
+    const char* data = content.data();
+    size_t remaining = content.size();
+    while (remaining > 0) {
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            unlink(tmp.c_str());
+            throw std::runtime_error("Failed to write file: " + path.string());
         }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        unlink(tmp.c_str());
+        throw std::runtime_error("Failed to write file: " + path.string());
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        throw std::runtime_error("Failed to replace file: " + path.string());
     }
-    pclose(pipe);
-    
-    return gcc_path;
 }
 
-std::string find_gpp_path() {
-    std::string gpp_path = "";
-    FILE* pipe = popen("which g++ 2>/dev/null", "r");
-    if (!pipe) return gpp_path;
-    
-    char buffer[256];
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        gpp_path = std::string(buffer);
-        // Remove trailing newline if present
-        if (!gpp_path.empty() && gpp_path.back() == '\n') {
-            gpp_path.pop_back();
+FileLock::FileLock(const fs::path& lock_file) {
+    fd_ = open(lock_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open lock file: " + lock_file.string());
+    }
+    while (flock(fd_, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            close(fd_);
+            throw std::runtime_error("Failed to lock: " + lock_file.string());
         }
     }
-    pclose(pipe);
-    
-    return gpp_path;
+}
+
+FileLock::~FileLock() {
+    flock(fd_, LOCK_UN);
+    close(fd_);
+}
+
+// Lock serializing writers of a project's .libpath and cproject.toml
+fs::path project_lock_path(const fs::path& root) {
+    return vc_state_dir(root) / "lock";
+}
+
+// Find gcc/g++ on PATH without forking 'which'
+std::string find_gcc_path() {
+    return find_in_path("gcc");
+}
+
+std::string find_gpp_path() {
+    return find_in_path("g++");
 }
 
 void create_project(const fs::path& root, const std::optional<std::string>& compiler, const std::optional<std::string>& global_install) {
@@ -132,7 +179,7 @@ void create_project(const fs::path& root, const std::optional<std::string>& comp
     // Create files
     create_file(root / ".gitignore", GITIGNORE_CONTENT);
     create_file(root / ".ignorepath", IGNOREPATH_CONTENT);
-    create_file(root / ".libpath", ""); // Empty at init
+    write_file_atomic(root / ".libpath", ""); // Empty at init
     create_file(root / "README.md", ""); // Empty or default message
 
     // cproject.toml
@@ -151,10 +198,9 @@ void create_project(const fs::path& root, const std::optional<std::string>& comp
     }
     proj.insert_or_assign("dependencies", toml::array{}); // Empty at init
 
-    std::ofstream tomlfile(root / "cproject.toml");
-    if (!tomlfile) throw std::runtime_error("Failed to create cproject.toml");
+    std::ostringstream tomlfile;
     tomlfile << tbl;
-    tomlfile.close();
+    write_file_atomic(root / "cproject.toml", tomlfile.str());
 }
 
 // Utility: read lines from a file into a set
@@ -196,32 +242,73 @@ bool is_package_installed(const fs::path& libpath, const std::string& pkg) {
     return false;
 }
 
-// Utility: append package info to .libpath
-void append_libpath(const fs::path& libpath, const std::string& pkg, const std::string& version,
-                  const std::vector<std::string>& includes, const std::vector<std::string>& libnames, const std::vector<std::string>& libpaths) {
-    std::ofstream out(libpath, std::ios::app);
-    out << "[" << pkg << "]\n";
-    out << "version = \"" << version << "\"\n";
+// Utility: drop the [pkg] section from .libpath content
+static std::string strip_libpath_section(const std::string& content, const std::string& pkg, bool& found) {
+    std::istringstream in(content);
+    std::string line;
+    std::string out;
+    bool in_package_section = false;
+    found = false;
+    
+    // Read all lines, skipping the target package's section
+    while (std::getline(in, line)) {
+        // Check if this line starts a new package section
+        if (!line.empty() && line[0] == '[') {
+            std::string section_pkg = line.substr(1, line.find(']') - 1);
+            if (section_pkg == pkg) {
+                in_package_section = true;
+                found = true;
+                continue; // Skip this line and package section
+            } else {
+                in_package_section = false;
+            }
+        }
+        
+        // Keep lines not in the target package section
+        if (!in_package_section) {
+            out += line + "\n";
+        }
+    }
+    return out;
+}
+
+// Utility: one [package] section of .libpath
+std::string libpath_section(const LibpathEntry& entry) {
+    std::ostringstream out;
+    out << "[" << entry.name << "]\n";
+    out << "version = \"" << entry.version << "\"\n";
     out << "includes = [";
-    for (size_t i = 0; i < includes.size(); ++i) {
+    for (size_t i = 0; i < entry.includes.size(); ++i) {
         if (i) out << ", ";
-        out << "\"" << includes[i] << "\"";
+        out << "\"" << entry.includes[i] << "\"";
     }
     out << "]\nlibnames = [";
-    for (size_t i = 0; i < libnames.size(); ++i) {
+    for (size_t i = 0; i < entry.libnames.size(); ++i) {
         if (i) out << ", ";
-        out << "\"" << libnames[i] << "\"";
+        out << "\"" << entry.libnames[i] << "\"";
     }
     out << "]\nlibpaths = [";
-    for (size_t i = 0; i < libpaths.size(); ++i) {
+    for (size_t i = 0; i < entry.libpaths.size(); ++i) {
         if (i) out << ", ";
-        out << "\"" << libpaths[i] << "\"";
+        out << "\"" << entry.libpaths[i] << "\"";
     }
     out << "]\n\n";
+    return out.str();
+}
+
+// Utility: append package info to .libpath, replacing any previous section for it
+void append_libpath(const fs::path& libpath, const std::string& pkg, const std::string& version,
+                  const std::vector<std::string>& includes, const std::vector<std::string>& libnames, const std::vector<std::string>& libpaths) {
+    FileLock lock(project_lock_path(libpath.parent_path()));
+    bool found = false;
+    std::string content = strip_libpath_section(read_file(libpath), pkg, found);
+
+    write_file_atomic(libpath, content + libpath_section({pkg, version, includes, libnames, libpaths}));
 }
 
 // Utility: update dependencies in cproject.toml
 void add_dependency_toml(const fs::path& tomlfile, const std::string& pkg, const std::string& version) {
+    FileLock lock(project_lock_path(tomlfile.parent_path()));
     auto tbl = toml::parse_file(tomlfile.string());
     auto* proj = tbl.get_as<toml::table>("project");
     if (!proj) return;
@@ -236,8 +323,9 @@ void add_dependency_toml(const fs::path& tomlfile, const std::string& pkg, const
         if (v.value<std::string>().value_or("") == depstr) return;
     }
     arr->push_back(depstr);
-    std::ofstream out(tomlfile);
+    std::ostringstream out;
     out << tbl;
+    write_file_atomic(tomlfile, out.str());
 }
 
 // Function to convert string to uppercase
@@ -268,171 +356,135 @@ bool check_package_installed(const fs::path& libpath, const std::string& pkg) {
     return is_package_installed(libpath, pkg);
 }
 
-// Function to build compiler arguments from .libpath
-std::vector<std::string> build_compiler_args(const fs::path& libpath_file) {
-    std::vector<std::string> args;
-    
+// Utility: parse a .libpath array line such as includes = ["a", "b"]
+static std::vector<std::string> parse_libpath_array(const std::string& line) {
+    std::vector<std::string> values;
+    size_t start_array = line.find('[');
+    size_t end_array = line.rfind(']');
+    if (start_array == std::string::npos || end_array == std::string::npos || end_array < start_array) {
+        return values;
+    }
+    std::string array_content = line.substr(start_array + 1, end_array - start_array - 1);
+    // Parse the array elements (simple split by commas)
+    size_t pos = 0;
+    while (true) {
+        pos = array_content.find(',');
+        std::string value = trim(array_content.substr(0, pos));
+        // Remove quotes if present
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+        if (!value.empty()) {
+            values.push_back(value);
+        }
+        if (pos == std::string::npos) break;
+        array_content.erase(0, pos + 1);
+    }
+    return values;
+}
+
+// Function to parse every package section of .libpath
+std::vector<LibpathEntry> read_libpath_entries(const fs::path& libpath_file) {
+    std::vector<LibpathEntry> entries;
+
     std::ifstream file(libpath_file);
     if (!file) {
-        return args;
+        return entries;
     }
-    
+
     std::string line;
-    std::string current_package;
-    std::vector<std::string> includes;
-    std::vector<std::string> libnames;
-    std::vector<std::string> libpaths;
-    
-    // Parse .libpath file
     while (std::getline(file, line)) {
         line = trim(line);
-        
+
         if (line.empty()) continue;
-        
+
         // Process section header [package-name]
         if (line[0] == '[') {
             size_t end_bracket = line.find(']');
             if (end_bracket != std::string::npos) {
                 // Start a new package
-                current_package = line.substr(1, end_bracket - 1);
+                LibpathEntry entry;
+                entry.name = line.substr(1, end_bracket - 1);
+                entries.push_back(entry);
             }
             continue;
         }
-        
+
         // Process package contents
-        if (!current_package.empty()) {
-            if (line.find("includes = [") == 0) {
-                // Extract includes array
-                size_t start_array = line.find('[');
-                size_t end_array = line.find(']');
-                if (start_array != std::string::npos && end_array != std::string::npos) {
-                    std::string array_content = line.substr(start_array + 1, end_array - start_array - 1);
-                    // Parse the array elements (simple split by commas)
-                    size_t pos = 0;
-                    while ((pos = array_content.find(',')) != std::string::npos) {
-                        std::string path = array_content.substr(0, pos);
-                        path = trim(path);
-                        // Remove quotes if present
-                        if (path.size() >= 2 && path.front() == '"' && path.back() == '"') {
-                            path = path.substr(1, path.size() - 2);
-                        }
-                        if (!path.empty()) {
-                            includes.push_back(path);
-                        }
-                        array_content.erase(0, pos + 1);
-                    }
-                    // Process the last element
-                    std::string path = trim(array_content);
-                    if (path.size() >= 2 && path.front() == '"' && path.back() == '"') {
-                        path = path.substr(1, path.size() - 2);
-                    }
-                    if (!path.empty()) {
-                        includes.push_back(path);
-                    }
-                }
-            }
-            else if (line.find("libnames = [") == 0) {
-                // Extract libnames array
-                size_t start_array = line.find('[');
-                size_t end_array = line.find(']');
-                if (start_array != std::string::npos && end_array != std::string::npos) {
-                    std::string array_content = line.substr(start_array + 1, end_array - start_array - 1);
-                    // Parse the array elements
-                    size_t pos = 0;
-                    while ((pos = array_content.find(',')) != std::string::npos) {
-                        std::string lib = array_content.substr(0, pos);
-                        lib = trim(lib);
-                        // Remove quotes if present
-                        if (lib.size() >= 2 && lib.front() == '"' && lib.back() == '"') {
-                            lib = lib.substr(1, lib.size() - 2);
-                        }
-                        if (!lib.empty()) {
-                            libnames.push_back(lib);
-                        }
-                        array_content.erase(0, pos + 1);
-                    }
-                    // Process the last element
-                    std::string lib = trim(array_content);
-                    if (lib.size() >= 2 && lib.front() == '"' && lib.back() == '"') {
-                        lib = lib.substr(1, lib.size() - 2);
-                    }
-                    if (!lib.empty()) {
-                        libnames.push_back(lib);
-                    }
-                }
-            }
-            else if (line.find("libpaths = [") == 0) {
-                // Extract libpaths array
-                size_t start_array = line.find('[');
-                size_t end_array = line.find(']');
-                if (start_array != std::string::npos && end_array != std::string::npos) {
-                    std::string array_content = line.substr(start_array + 1, end_array - start_array - 1);
-                    // Parse the array elements
-                    size_t pos = 0;
-                    while ((pos = array_content.find(',')) != std::string::npos) {
-                        std::string path = array_content.substr(0, pos);
-                        path = trim(path);
-                        // Remove quotes if present
-                        if (path.size() >= 2 && path.front() == '"' && path.back() == '"') {
-                            path = path.substr(1, path.size() - 2);
-                        }
-                        if (!path.empty()) {
-                            libpaths.push_back(path);
-                        }
-                        array_content.erase(0, pos + 1);
-                    }
-                    // Process the last element
-                    std::string path = trim(array_content);
-                    if (path.size() >= 2 && path.front() == '"' && path.back() == '"') {
-                        path = path.substr(1, path.size() - 2);
-                    }
-                    if (!path.empty()) {
-                        libpaths.push_back(path);
-                    }
-                }
+        if (entries.empty()) continue;
+        LibpathEntry& current = entries.back();
+        if (line.find("version") == 0) {
+            size_t start_quote = line.find('"');
+            size_t end_quote = line.find('"', start_quote + 1);
+            if (start_quote != std::string::npos && end_quote != std::string::npos) {
+                current.version = line.substr(start_quote + 1, end_quote - start_quote - 1);
             }
+        } else if (line.find("includes = [") == 0) {
+            current.includes = parse_libpath_array(line);
+        } else if (line.find("libnames = [") == 0) {
+            current.libnames = parse_libpath_array(line);
+        } else if (line.find("libpaths = [") == 0) {
+            current.libpaths = parse_libpath_array(line);
         }
     }
-    
+
+    return entries;
+}
+
+// Function to build compiler arguments from .libpath
+std::vector<std::string> build_compiler_args(const fs::path& libpath_file) {
+    std::vector<std::string> args;
+    std::vector<LibpathEntry> entries = read_libpath_entries(libpath_file);
+
     // Build args from parsed information
-    for (const auto& include : includes) {
-        args.push_back("-I" + include);
+    for (const auto& entry : entries) {
+        for (const auto& include : entry.includes) {
+            args.push_back("-I" + include);
+        }
     }
-    
-    for (const auto& libpath : libpaths) {
-        args.push_back("-L" + libpath);
+
+    for (const auto& entry : entries) {
+        for (const auto& libpath : entry.libpaths) {
+            args.push_back("-L" + libpath);
+        }
     }
-    
-    for (const auto& lib : libnames) {
-        args.push_back("-l" + lib);
+
+    for (const auto& entry : entries) {
+        for (const auto& lib : entry.libnames) {
+            args.push_back("-l" + lib);
+        }
     }
-    
+
     return args;
 }
 
-// Get dependencies from cproject.toml
-std::vector<std::string> get_dependencies(const fs::path& toml_file) {
-    std::vector<std::string> deps;
+// Split compiler arguments into compile-only and link-only flags
+void split_compiler_args(const std::vector<std::string>& args, std::vector<std::string>& compile_args, std::vector<std::string>& link_args) {
+    for (const auto& arg : args) {
+        if (arg.rfind("-L", 0) == 0 || arg.rfind("-l", 0) == 0 || arg.rfind("-Wl,", 0) == 0) {
+            link_args.push_back(arg);
+        } else {
+            compile_args.push_back(arg);
+        }
+    }
+}
+
+// Get dependency specs ("pkg==version") from cproject.toml
+std::vector<std::string> get_dependency_specs(const fs::path& toml_file) {
+    std::vector<std::string> specs;
     
     try {
         auto tbl = toml::parse_file(toml_file.string());
         auto* proj = tbl.get_as<toml::table>("project");
-        if (!proj) return deps;
+        if (!proj) return specs;
         
         if (auto dep_node = proj->get("dependencies"); dep_node && dep_node->is_array()) {
             auto* deps_arr = dep_node->as_array();
-            if (!deps_arr) return deps;
+            if (!deps_arr) return specs;
             
             for (auto& dep : *deps_arr) {
                 if (auto dep_str = dep.value<std::string>()) {
-                    std::string dep_val = *dep_str;
-                    // Extract package name from "pkg==version"
-                    size_t pos = dep_val.find("==");
-                    if (pos != std::string::npos) {
-                        deps.push_back(dep_val.substr(0, pos));
-                    } else {
-                        deps.push_back(dep_val);
-                    }
+                    specs.push_back(*dep_str);
                 }
             }
         }
@@ -440,6 +492,23 @@ std::vector<std::string> get_dependencies(const fs::path& toml_file) {
         std::cerr << "Error parsing cproject.toml: " << ex.what() << std::endl;
     }
     
+    return specs;
+}
+
+// Get dependencies from cproject.toml
+std::vector<std::string> get_dependencies(const fs::path& toml_file) {
+    std::vector<std::string> deps;
+    
+    for (const auto& dep_val : get_dependency_specs(toml_file)) {
+        // Extract package name from "pkg==version"
+        size_t pos = dep_val.find("==");
+        if (pos != std::string::npos) {
+            deps.push_back(dep_val.substr(0, pos));
+        } else {
+            deps.push_back(dep_val);
+        }
+    }
+    
     return deps;
 }
 
@@ -464,56 +533,169 @@ std::string get_compiler_path(const fs::path& toml_file) {
     return "gcc";
 }
 
-// Function to remove package info from .libpath
-bool remove_package_from_libpath(const fs::path& libpath_file, const std::string& pkg) {
-    std::ifstream infile(libpath_file);
-    if (!infile) {
-        return false;
+// Get a string option from the [project] table of cproject.toml
+std::string get_project_setting(const fs::path& toml_file, const std::string& key, const std::string& default_value) {
+    try {
+        auto tbl = toml::parse_file(toml_file.string());
+        auto* proj = tbl.get_as<toml::table>("project");
+        if (!proj) return default_value;
+
+        if (auto node = proj->get(key); node && node->is_string()) {
+            return node->value_or(default_value);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error parsing cproject.toml: " << ex.what() << std::endl;
     }
-    
-    std::string line;
-    std::vector<std::string> lines;
-    bool in_package_section = false;
-    bool found = false;
-    
-    // Read all lines, skipping the target package's section
-    while (std::getline(infile, line)) {
-        // Check if this line starts a new package section
-        if (!line.empty() && line[0] == '[') {
-            std::string section_pkg = line.substr(1, line.find(']') - 1);
-            if (section_pkg == pkg) {
-                in_package_section = true;
-                found = true;
-                continue; // Skip this line and package section
+    return default_value;
+}
+
+// Get a boolean option from the [project] table of cproject.toml
+bool get_project_flag(const fs::path& toml_file, const std::string& key, bool default_value) {
+    try {
+        auto tbl = toml::parse_file(toml_file.string());
+        auto* proj = tbl.get_as<toml::table>("project");
+        if (!proj) return default_value;
+
+        if (auto node = proj->get(key); node && node->is_boolean()) {
+            return node->value_or(default_value);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error parsing cproject.toml: " << ex.what() << std::endl;
+    }
+    return default_value;
+}
+
+// Name of the active build profile: $VC_PROFILE, else [project] profile, else "default"
+std::string get_active_profile(const fs::path& toml_file) {
+    if (const char* env = getenv("VC_PROFILE"); env && *env) {
+        return env;
+    }
+    return get_project_setting(toml_file, "profile", "default");
+}
+
+// Get a string option from the active [profile.<name>] table of cproject.toml
+std::string get_profile_setting(const fs::path& toml_file, const std::string& key, const std::string& default_value) {
+    std::string profile = get_active_profile(toml_file);
+    try {
+        auto tbl = toml::parse_file(toml_file.string());
+        auto* profiles = tbl.get_as<toml::table>("profile");
+        if (!profiles) return default_value;
+        auto* active = profiles->get_as<toml::table>(profile);
+        if (!active) return default_value;
+
+        if (auto node = active->get(key); node && node->is_string()) {
+            return node->value_or(default_value);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error parsing cproject.toml: " << ex.what() << std::endl;
+    }
+    return default_value;
+}
+
+// Utility: split a flag string on whitespace
+std::vector<std::string> split_flags(const std::string& flags) {
+    std::vector<std::string> result;
+    std::istringstream iss(flags);
+    std::string flag;
+    while (iss >> flag) result.push_back(flag);
+    return result;
+}
+
+// Utility: resolve an executable through $PATH without forking
+std::string find_in_path(const std::string& name) {
+    const char* path_env = getenv("PATH");
+    if (!path_env) return "";
+    std::istringstream dirs(path_env);
+    std::string dir;
+    while (std::getline(dirs, dir, ':')) {
+        if (dir.empty()) dir = ".";
+        fs::path candidate = fs::path(dir) / name;
+        if (access(candidate.c_str(), X_OK) == 0 && !fs::is_directory(candidate)) {
+            return candidate.string();
+        }
+    }
+    return "";
+}
+
+// Build linker flags recording .libpath library directories as DT_RUNPATH entries.
+// Directories inside the project are made $ORIGIN-relative to output_dir unless
+// rpath = "absolute" is set; rpath = "none" disables embedding entirely.
+std::vector<std::string> build_rpath_args(const fs::path& libpath_file, const fs::path& toml_file, const fs::path& output_dir) {
+    std::vector<std::string> args;
+    std::string mode = get_project_setting(toml_file, "rpath", "origin");
+    if (mode == "none") return args;
+
+    fs::path root = fs::absolute(libpath_file).parent_path();
+    std::set<std::string> seen;
+    for (const auto& entry : read_libpath_entries(libpath_file)) {
+        for (const auto& libpath : entry.libpaths) {
+            if (!seen.insert(libpath).second) continue;
+            fs::path dir = fs::absolute(libpath).lexically_normal();
+            fs::path rel_to_root = dir.lexically_relative(root);
+            bool in_project = !rel_to_root.empty() && *rel_to_root.begin() != "..";
+            if (mode == "origin" && in_project) {
+                fs::path rel = dir.lexically_relative(fs::absolute(output_dir).lexically_normal());
+                args.push_back("-Wl,-rpath,$ORIGIN/" + rel.string());
             } else {
-                in_package_section = false;
+                args.push_back("-Wl,-rpath," + dir.string());
             }
         }
-        
-        // Keep lines not in the target package section
-        if (!in_package_section) {
-            lines.push_back(line);
+    }
+    if (!args.empty()) {
+        args.insert(args.begin(), "-Wl,--enable-new-dtags");
+    }
+
+    // Resolve all symbols at load time instead of lazily on first call
+    if (get_project_flag(toml_file, "bindnow", false)) {
+        args.push_back("-Wl,-z,now");
+    }
+    return args;
+}
+
+// Derive the C and C++ driver pair from the configured compiler
+void derive_c_cxx(const std::string& compiler, std::string& cc, std::string& cxx) {
+    static const std::vector<std::pair<std::string, std::string>> pairs = {
+        {"clang", "clang++"}, {"gcc", "g++"}, {"icx", "icpx"}, {"cc", "c++"}
+    };
+    cc = compiler;
+    cxx = compiler;
+    fs::path path(compiler);
+    std::string name = path.filename().string();
+    for (const auto& pair : pairs) {
+        size_t pos;
+        if ((pos = name.find(pair.second)) != std::string::npos) {
+            cc = (path.parent_path() / (name.substr(0, pos) + pair.first + name.substr(pos + pair.second.size()))).string();
+            return;
+        }
+        if ((pos = name.find(pair.first)) != std::string::npos) {
+            cxx = (path.parent_path() / (name.substr(0, pos) + pair.second + name.substr(pos + pair.first.size()))).string();
+            return;
         }
     }
-    
-    infile.close();
-    
-    // Write back the file without the package section
-    std::ofstream outfile(libpath_file);
-    if (!outfile) {
+}
+
+// Function to remove package info from .libpath
+bool remove_package_from_libpath(const fs::path& libpath_file, const std::string& pkg) {
+    if (!fs::exists(libpath_file)) {
         return false;
     }
     
-    for (const auto& l : lines) {
-        outfile << l << std::endl;
+    FileLock lock(project_lock_path(libpath_file.parent_path()));
+    bool found = false;
+    std::string content = strip_libpath_section(read_file(libpath_file), pkg, found);
+    if (!found) {
+        return false;
     }
     
-    return found;
+    // Write back the file without the package section
+    write_file_atomic(libpath_file, content);
+    return true;
 }
 
 // Function to remove package from cproject.toml dependencies
 void remove_dependency_toml(const fs::path& tomlfile, const std::string& pkg) {
     try {
+        FileLock lock(project_lock_path(tomlfile.parent_path()));
         auto tbl = toml::parse_file(tomlfile.string());
         auto* proj = tbl.get_as<toml::table>("project");
         if (!proj) return;
@@ -540,14 +722,318 @@ void remove_dependency_toml(const fs::path& tomlfile, const std::string& pkg) {
             proj->insert_or_assign("dependencies", std::move(new_deps));
             
             // Write updated TOML to file
-            std::ofstream out(tomlfile);
+            std::ostringstream out;
             out << tbl;
+            write_file_atomic(tomlfile, out.str());
         }
     } catch (const std::exception& ex) {
         std::cerr << "Warning: Error removing dependency from cproject.toml: " << ex.what() << std::endl;
     }
 }
 
+// Internal state directory of a project, kept inside .venv so it is ignored and cleared with it
+fs::path vc_state_dir(const fs::path& root) {
+    fs::path dir = root / ".venv" / ".vc";
+    fs::create_directories(dir);
+    return dir;
+}
+
+// Per-user cache shared by all projects ($VC_CACHE_DIR, $XDG_CACHE_HOME/vc or ~/.cache/vc)
+fs::path vc_cache_dir() {
+    fs::path dir;
+    if (const char* env = getenv("VC_CACHE_DIR"); env && *env) {
+        dir = env;
+    } else if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        dir = fs::path(xdg) / "vc";
+    } else if (const char* home = getenv("HOME"); home && *home) {
+        dir = fs::path(home) / ".cache" / "vc";
+    } else {
+        dir = fs::temp_directory_path() / ("vc-cache-" + std::to_string(getuid()));
+    }
+    fs::create_directories(dir);
+    return dir;
+}
+
+// Global vc config: $VC_CONFIG, else $XDG_CONFIG_HOME/vc/config.toml, else ~/.config/vc/config.toml
+fs::path vc_config_path() {
+    if (const char* env = getenv("VC_CONFIG"); env && *env) {
+        return env;
+    }
+    if (const char* xdg = getenv("XDG_CONFIG_HOME"); xdg && *xdg) {
+        return fs::path(xdg) / "vc" / "config.toml";
+    }
+    if (const char* home = getenv("HOME"); home && *home) {
+        return fs::path(home) / ".config" / "vc" / "config.toml";
+    }
+    return fs::path();
+}
+
+// Read the [mirror] table of the global config; VC_SCRIPTS_MIRROR,
+// VC_DOWNLOAD_MIRROR and VC_OFFLINE override it per invocation
+MirrorConfig read_mirror_config() {
+    MirrorConfig config;
+    fs::path path = vc_config_path();
+    if (!path.empty() && fs::exists(path)) {
+        try {
+            auto tbl = toml::parse_file(path.string());
+            if (auto* mirror = tbl.get_as<toml::table>("mirror")) {
+                config.scripts = mirror->get("scripts") ? mirror->get("scripts")->value_or(std::string()) : "";
+                config.downloads = mirror->get("downloads") ? mirror->get("downloads")->value_or(std::string()) : "";
+                config.offline = mirror->get("offline") ? mirror->get("offline")->value_or(false) : false;
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "Error parsing " << path << ": " << ex.what() << std::endl;
+        }
+    }
+    if (const char* env = getenv("VC_SCRIPTS_MIRROR"); env && *env) config.scripts = env;
+    if (const char* env = getenv("VC_DOWNLOAD_MIRROR"); env && *env) config.downloads = env;
+    if (const char* env = getenv("VC_OFFLINE"); env && *env) config.offline = std::string(env) != "0";
+    return config;
+}
+
+// Utility: true for sources that need the network (anything but a local path or file:// URL)
+bool is_network_url(const std::string& source) {
+    if (source.rfind("file://", 0) == 0) return false;
+    if (source.find("://") != std::string::npos) return true;
+    // scp-like git remotes: user@host:path
+    size_t colon = source.find(':');
+    return colon != std::string::npos && source.find('/') > colon;
+}
+
+// Utility: modification time of a file, or nullopt if it does not exist
+static std::optional<struct timespec> file_mtime(const fs::path& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return std::nullopt;
+    return st.st_mtim;
+}
+
+static bool mtime_newer(const struct timespec& a, const struct timespec& b) {
+    return a.tv_sec > b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec > b.tv_nsec);
+}
+
+// Utility: read the prerequisites listed in a make-style depfile
+std::vector<fs::path> read_depfile(const fs::path& depfile) {
+    std::vector<fs::path> deps;
+    std::ifstream in(depfile);
+    if (!in) return deps;
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // Skip the target part up to the first ": "
+    size_t colon = content.find(": ");
+    if (colon == std::string::npos) return deps;
+
+    std::string current;
+    for (size_t i = colon + 2; i < content.size(); ++i) {
+        char c = content[i];
+        if (c == '\\' && i + 1 < content.size()) {
+            char next = content[i + 1];
+            if (next == '\n') { ++i; continue; }
+            if (next == ' ' || next == '#') { current += next; ++i; continue; }
+        }
+        // Only the first rule lists prerequisites; -fmodules-ts appends module rules after it
+        if (c == '\n') break;
+        if (c == ' ' || c == '\t' || c == '\r') {
+            if (!current.empty()) deps.push_back(current);
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty()) deps.push_back(current);
+    return deps;
+}
+
+// Check whether output is newer than every input and was built by the same command
+bool is_up_to_date(const fs::path& output, const std::vector<fs::path>& inputs,
+                   const fs::path& depfile, const fs::path& cmdfile, const std::string& cmd) {
+    auto output_time = file_mtime(output);
+    if (!output_time) return false;
+
+    std::ifstream in(cmdfile);
+    std::string previous_cmd;
+    if (!std::getline(in, previous_cmd) || previous_cmd != cmd) return false;
+
+    std::vector<fs::path> all_inputs = inputs;
+    std::vector<fs::path> deps = read_depfile(depfile);
+    if (deps.empty()) return false;
+    all_inputs.insert(all_inputs.end(), deps.begin(), deps.end());
+
+    for (const auto& input : all_inputs) {
+        auto input_time = file_mtime(input);
+        if (!input_time || mtime_newer(*input_time, *output_time)) return false;
+    }
+    return true;
+}
+
+// Utility: check if a path looks like a C/C++ translation unit
+bool is_source_file(const fs::path& path) {
+    static const std::set<std::string> extensions = {".c", ".cc", ".cpp", ".cxx", ".c++"};
+    return extensions.count(path.extension().string()) > 0;
+}
+
+// Utility: collect project sources, skipping hidden directories and build outputs;
+// directories, when given, receives every directory searched, root first
+std::vector<fs::path> collect_sources(const fs::path& root, std::vector<fs::path>* directories) {
+    std::vector<fs::path> sources;
+    std::error_code ec;
+    if (directories) directories->push_back(root);
+    for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        const fs::path& path = it->path();
+        std::string name = path.filename().string();
+        if (it->is_directory(ec)) {
+            if (name.empty() || name[0] == '.' || name == "build" || name == "CMakeFiles") {
+                it.disable_recursion_pending();
+            } else if (directories) {
+                directories->push_back(path);
+            }
+            continue;
+        }
+        if (it->is_regular_file(ec) && is_source_file(path)) {
+            sources.push_back(path);
+        }
+    }
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+// Utility: 64-bit FNV-1a hash as hex, used for cache keys and signatures
+std::string hash_string(const std::string& data) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+// Utility: escape a string for inclusion in JSON output
+std::string json_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size() + 2);
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buffer[7];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out;
+}
+
+// Utility: JSON array of strings
+std::string json_string_array(const std::vector<std::string>& values) {
+    std::string out = "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i) out += ", ";
+        out += "\"" + json_escape(values[i]) + "\"";
+    }
+    return out + "]";
+}
+
+// Descriptor of the real stdout while JSON output is enabled, -1 otherwise
+static int json_fd = -1;
+
+// Point fd 1 at stderr so everything vc and its children print stays off the
+// JSON document, which is written to a saved copy of the original stdout
+void enable_json_output() {
+    if (json_fd >= 0) return;
+    std::cout.flush();
+    fflush(stdout);
+    json_fd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+    if (json_fd < 0) return;
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    // Keep text in order with what children write to the same stderr
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+}
+
+bool json_output_enabled() {
+    return json_fd >= 0;
+}
+
+void write_json_output(const std::string& json) {
+    std::string document = json + "\n";
+    int fd = json_fd >= 0 ? json_fd : STDOUT_FILENO;
+    std::cout.flush();
+    size_t written = 0;
+    while (written < document.size()) {
+        ssize_t n = write(fd, document.data() + written, document.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+// Utility: quote an argument for /bin/sh when it contains special characters
+std::string shell_quote(const std::string& s) {
+    if (!s.empty() && s.find_first_of(" \t\n'\"\\$`&|;<>()*?[]#~{}!") == std::string::npos) {
+        return s;
+    }
+    std::string out = "'";
+    for (char c : s) {
+        if (c == '\'') {
+            out += "'\\''";
+        } else {
+            out += c;
+        }
+    }
+    out += "'";
+    return out;
+}
+
+// Number of parallel jobs to use by default
+unsigned default_jobs() {
+    unsigned jobs = std::thread::hardware_concurrency();
+    return jobs ? jobs : 1;
+}
+
+// Utility: run fn(0..count-1) across a pool of worker threads
+void parallel_for(size_t count, const std::function<void(size_t)>& fn, unsigned jobs) {
+    if (jobs == 0) jobs = default_jobs();
+    size_t workers = std::min<size_t>(jobs, count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    // An exception escaping a thread would terminate vc; the first one stops
+    // further items from starting and is rethrown to the caller after the join
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers; ++w) {
+        threads.emplace_back([&]() {
+            for (size_t i = next++; i < count; i = next++) {
+                try {
+                    fn(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                    next = count;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+}
+
 void print_help() {
     std::cerr << "Usage: vc <command> [arguments]" << std::endl;
     std::cerr << "Commands:" << std::endl;
@@ -555,9 +1041,23 @@ void print_help() {
     std::cerr << "  install <packages...>  Install one or more packages" << std::endl;
     std::cerr << "  uninstall <packages...> Uninstall one or more packages" << std::endl;
     std::cerr << "  list                   List installed packages" << std::endl;
-    std::cerr << "  run <filename>         Compile and run a file with dependencies" << std::endl;
+    std::cerr << "  run <filename> [-- args] Compile and run a file with dependencies" << std::endl;
+    std::cerr << "  run --each <dir|glob>  Compile and run every entry point in parallel" << std::endl;
     std::cerr << "  upgrade               Upgrade library scripts from repository" << std::endl;
+    std::cerr << "  search [query]         Search available library scripts" << std::endl;
     std::cerr << "  clear                  Remove all project files and directories" << std::endl;
+    std::cerr << "  generate [--force]     Write compile_commands.json and build.ninja" << std::endl;
+    std::cerr << "  env                    Print a shell activation script for the project" << std::endl;
+    std::cerr << "  shell                  Start a shell inside the project environment" << std::endl;
+    std::cerr << "  sync [-j N]            Install and remove packages to match cproject.lock" << std::endl;
+    std::cerr << "  verify [--repair]      Check .venv packages against their install manifests" << std::endl;
+    std::cerr << "  pack [-o archive]      Archive .venv and .libpath (zstd)" << std::endl;
+    std::cerr << "  unpack [archive]       Restore and rebase an archive from vc pack" << std::endl;
+    std::cerr << "  dedupe [root]          Hardlink identical files across .venv trees" << std::endl;
+    std::cerr << "  worker [-l address]    Serve compile jobs for vc run on other machines" << std::endl;
+    std::cerr << "  workspace [-j N]       Install workspace members' dependencies once and link them in" << std::endl;
+    std::cerr << "Options for list, install and run:" << std::endl;
+    std::cerr << "  --format=json          Print a JSON report on stdout; other output goes to stderr" << std::endl;
     std::cerr << "Options for init:" << std::endl;
     std::cerr << "  -c, --compiler         Set compiler path (can be any compiler)" << std::endl;
     std::cerr << "  -x, --cxx              Use g++ as default compiler instead of gcc" << std::endl;
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -15,6 +16,9 @@
 #include <toml++/toml.hpp>
 #include <set>
 #include <ctime>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 
 namespace fs = std::filesystem;
 
@@ -33,8 +37,15 @@ extern const char* IGNOREPATH_CONTENT;
 // Library scripts directory
 extern std::string libs_dir;
 
+// Repository vc upgrade fetches scripts from when no mirror is configured
+#ifndef VIRTUALC_SCRIPTS_REPO
+#define VIRTUALC_SCRIPTS_REPO "https://github.com/powdersnow0604/linux_scripts.git"
+#endif
+
 // Utility functions
 void create_file(const fs::path& path, const std::string& content = "");
+std::string read_file(const fs::path& path);
+void write_file_atomic(const fs::path& path, const std::string& content);
 std::string find_gcc_path();
 std::string find_gpp_path();
 std::set<std::string> read_lines_set(const fs::path& file);
@@ -49,11 +60,76 @@ std::string to_lowercase(const std::string& str);
 int execute_command(const std::string& command);
 bool check_package_installed(const fs::path& libpath, const std::string& pkg);
 std::vector<std::string> build_compiler_args(const fs::path& libpath_file);
+void split_compiler_args(const std::vector<std::string>& args, std::vector<std::string>& compile_args, std::vector<std::string>& link_args);
 std::vector<std::string> get_dependencies(const fs::path& toml_file);
+std::vector<std::string> get_dependency_specs(const fs::path& toml_file);
 std::string get_compiler_path(const fs::path& toml_file);
+std::string get_project_setting(const fs::path& toml_file, const std::string& key, const std::string& default_value);
+bool get_project_flag(const fs::path& toml_file, const std::string& key, bool default_value);
+std::vector<std::string> build_rpath_args(const fs::path& libpath_file, const fs::path& toml_file, const fs::path& output_dir);
+std::string get_active_profile(const fs::path& toml_file);
+std::string get_profile_setting(const fs::path& toml_file, const std::string& key, const std::string& default_value);
+std::vector<std::string> split_flags(const std::string& flags);
+std::string find_in_path(const std::string& name);
+void derive_c_cxx(const std::string& compiler, std::string& cc, std::string& cxx);
 void remove_dependency_toml(const fs::path& tomlfile, const std::string& pkg);
 bool remove_package_from_libpath(const fs::path& libpath_file, const std::string& pkg);
 
+// Parsed [package] section of .libpath
+struct LibpathEntry {
+    std::string name;
+    std::string version;
+    std::vector<std::string> includes;
+    std::vector<std::string> libnames;
+    std::vector<std::string> libpaths;
+};
+std::vector<LibpathEntry> read_libpath_entries(const fs::path& libpath_file);
+std::string libpath_section(const LibpathEntry& entry);
+
+// Advisory exclusive flock() held for the lifetime of the object
+class FileLock {
+public:
+    explicit FileLock(const fs::path& lock_file);
+    ~FileLock();
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+fs::path project_lock_path(const fs::path& root);
+
+// Internal state directory of a project (.venv/.vc)
+fs::path vc_state_dir(const fs::path& root);
+fs::path vc_cache_dir();
+
+// Script and download mirrors from the global vc config ([mirror] table)
+struct MirrorConfig {
+    std::string scripts;    // git URL or local directory holding the library scripts
+    std::string downloads;  // base URL or local directory holding source archives
+    bool offline = false;   // refuse every network source
+};
+fs::path vc_config_path();
+MirrorConfig read_mirror_config();
+bool is_network_url(const std::string& source);
+bool is_source_file(const fs::path& path);
+std::vector<fs::path> read_depfile(const fs::path& depfile);
+bool is_up_to_date(const fs::path& output, const std::vector<fs::path>& inputs,
+                   const fs::path& depfile, const fs::path& cmdfile, const std::string& cmd);
+std::vector<fs::path> collect_sources(const fs::path& root, std::vector<fs::path>* directories = nullptr);
+std::string hash_string(const std::string& data);
+std::string json_escape(const std::string& s);
+std::string json_string_array(const std::vector<std::string>& values);
+
+// --format=json: stdout carries only the JSON document; human-readable output,
+// including that of compilers and install scripts, moves to stderr
+void enable_json_output();
+bool json_output_enabled();
+void write_json_output(const std::string& json);
+std::string shell_quote(const std::string& s);
+unsigned default_jobs();
+void parallel_for(size_t count, const std::function<void(size_t)>& fn, unsigned jobs = 0);
+
 // Create project with the given parameters
 void create_project(const fs::path& root, const std::optional<std::string>& compiler, const std::optional<std::string>& global_install);
 
@@ -0,0 +1,179 @@
+#include "virtualc_compiler.h"
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char* FINGERPRINT_HEADER = "VCCOMPILER1";
+
+// Optional flags vc adds on its own when the compiler takes them, with the language to probe in
+const std::pair<const char*, const char*> PROBED_FLAGS[] = {
+    {"-fmodules-ts", "c++"},
+    {"-gsplit-dwarf", "c"},
+    {"-gz", "c"},
+};
+
+// Identity of the binary on disk; a reinstalled or upgraded compiler changes it
+std::string binary_stamp(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return "";
+    long long mtime_ns = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return std::to_string(st.st_ino) + " " + std::to_string(mtime_ns) + " " + std::to_string(st.st_size);
+}
+
+bool is_cxx_driver(const std::string& compiler) {
+    std::string name = fs::path(compiler).filename().string();
+    return name.find("++") != std::string::npos;
+}
+
+// Directories listed between the markers of -E -v output
+std::vector<std::string> default_include_dirs(const std::string& compiler, const std::string& language) {
+    std::vector<std::string> dirs;
+    std::istringstream lines(run_cmd(shell_quote(compiler) + " -x " + language + " -E -v - </dev/null 2>&1"));
+    std::string line;
+    bool in_list = false;
+    while (std::getline(lines, line)) {
+        if (line.rfind("#include <...> search starts here:", 0) == 0) {
+            in_list = true;
+        } else if (line.rfind("End of search list.", 0) == 0) {
+            break;
+        } else if (in_list) {
+            // Darwin appends " (framework directory)"
+            std::string dir = trim(line.substr(0, line.find(" (")));
+            if (!dir.empty()) dirs.push_back(dir);
+        }
+    }
+    return dirs;
+}
+
+// Flags the compiler accepts without a warning, checked by compiling an empty unit
+std::vector<std::string> supported_flags(const std::string& compiler) {
+    std::vector<std::string> flags;
+    fs::path probe_dir = vc_cache_dir() / "compilers";
+    std::string dir_template = (probe_dir / "probe-XXXXXX").string();
+    if (!mkdtemp(dir_template.data())) return flags;
+    fs::path dir = dir_template;
+    for (const auto& [flag, language] : PROBED_FLAGS) {
+        std::string cmd = shell_quote(compiler) + " -x " + language + " -Werror " + flag + " -c -o " +
+                          shell_quote((dir / "probe.o").string()) + " - </dev/null >/dev/null 2>&1";
+        if (std::system(cmd.c_str()) == 0) flags.push_back(flag);
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return flags;
+}
+
+CompilerFingerprint probe(const std::string& compiler, const std::string& path) {
+    CompilerFingerprint fp;
+    fp.path = path;
+    std::string quoted = shell_quote(path);
+    std::string banner = run_cmd(quoted + " --version 2>/dev/null");
+    fp.version = trim(banner.substr(0, banner.find('\n')));
+    if (banner.find("clang") != std::string::npos) {
+        fp.family = "clang";
+    } else if (banner.find("Free Software Foundation") != std::string::npos) {
+        fp.family = "gcc";
+    } else {
+        fp.family = "unknown";
+    }
+    std::string version = trim(run_cmd(quoted + " -dumpversion 2>/dev/null"));
+    fp.major = version.substr(0, version.find('.'));
+    fp.target = trim(run_cmd(quoted + " -dumpmachine 2>/dev/null"));
+    fp.include_dirs = default_include_dirs(path, is_cxx_driver(compiler) ? "c++" : "c");
+    fp.flags = supported_flags(path);
+    return fp;
+}
+
+std::string fingerprint_key(const CompilerFingerprint& fp) {
+    std::string data = fp.path + "\n" + fp.version + "\n" + fp.family + "\n" + fp.major + "\n" + fp.target + "\n";
+    for (const auto& dir : fp.include_dirs) data += "include " + dir + "\n";
+    for (const auto& flag : fp.flags) data += "flag " + flag + "\n";
+    return hash_string(data);
+}
+
+std::string serialize(const CompilerFingerprint& fp, const std::string& stamp) {
+    std::string out = std::string(FINGERPRINT_HEADER) + "\n";
+    out += "stamp " + stamp + "\n";
+    out += "path " + fp.path + "\n";
+    out += "version " + fp.version + "\n";
+    out += "family " + fp.family + "\n";
+    out += "major " + fp.major + "\n";
+    out += "target " + fp.target + "\n";
+    for (const auto& dir : fp.include_dirs) out += "include " + dir + "\n";
+    for (const auto& flag : fp.flags) out += "flag " + flag + "\n";
+    return out;
+}
+
+// Cached fingerprint if it was taken from the binary as it is now
+std::optional<CompilerFingerprint> load(const fs::path& cache_file, const std::string& stamp) {
+    std::istringstream in(read_file(cache_file));
+    std::string line;
+    if (!std::getline(in, line) || line != FINGERPRINT_HEADER) return std::nullopt;
+    if (!std::getline(in, line) || line != "stamp " + stamp) return std::nullopt;
+    CompilerFingerprint fp;
+    while (std::getline(in, line)) {
+        size_t space = line.find(' ');
+        std::string field = line.substr(0, space);
+        std::string value = space == std::string::npos ? "" : line.substr(space + 1);
+        if (field == "path") fp.path = value;
+        else if (field == "version") fp.version = value;
+        else if (field == "family") fp.family = value;
+        else if (field == "major") fp.major = value;
+        else if (field == "target") fp.target = value;
+        else if (field == "include") fp.include_dirs.push_back(value);
+        else if (field == "flag") fp.flags.push_back(value);
+    }
+    return fp;
+}
+
+} // namespace
+
+std::string CompilerFingerprint::abi() const {
+    if (path.empty() || target.empty()) return "";
+    return target + " " + family + "-" + major;
+}
+
+bool CompilerFingerprint::supports(const std::string& flag) const {
+    return std::find(flags.begin(), flags.end(), flag) != flags.end();
+}
+
+// Fingerprint of a compiler named as in cproject.toml (a path or a PATH lookup)
+const CompilerFingerprint& compiler_fingerprint(const std::string& compiler) {
+    static std::mutex mutex;
+    static std::map<std::string, CompilerFingerprint> fingerprints;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto it = fingerprints.find(compiler); it != fingerprints.end()) return it->second;
+
+    CompilerFingerprint& fp = fingerprints[compiler];
+    std::string found = compiler.find('/') != std::string::npos ? compiler : find_in_path(compiler);
+    std::error_code ec;
+    std::string path = found.empty() ? "" : fs::canonical(found, ec).string();
+    std::string stamp = path.empty() ? "" : binary_stamp(path);
+    if (stamp.empty()) {
+        // Nothing to probe; commands still run it as named
+        fp.family = "unknown";
+        fp.key = hash_string("unresolved\n" + compiler);
+        return fp;
+    }
+
+    // g++ and gcc may share a binary but search different include directories
+    std::string language = is_cxx_driver(compiler) ? "c++" : "c";
+    fs::path cache_file = vc_cache_dir() / "compilers" / (hash_string(path + "\n" + language) + ".fingerprint");
+    if (auto cached = load(cache_file, stamp)) {
+        fp = *cached;
+    } else {
+        fs::create_directories(cache_file.parent_path(), ec);
+        fp = probe(compiler, path);
+        write_file_atomic(cache_file, serialize(fp, stamp));
+    }
+    fp.key = fingerprint_key(fp);
+    return fp;
+}
+
+// cmd tagged with the fingerprint of compiler, as build caches record it in
+// their .cmd files: the same command run by a different compiler is stale
+std::string fingerprinted_command(const std::string& compiler, const std::string& cmd) {
+    return cmd + "  # compiler " + compiler_fingerprint(compiler).key;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// What a compiler binary is and can do, probed once per binary and cached in
+// vc_cache_dir() under its inode, mtime and size
+struct CompilerFingerprint {
+    std::string path;                       // resolved binary, symlinks followed; empty if not found
+    std::string version;                    // first line of --version
+    std::string family;                     // "gcc", "clang" or "unknown"
+    std::string major;                      // major version from -dumpversion
+    std::string target;                     // -dumpmachine triple
+    std::vector<std::string> include_dirs;  // default #include <...> search list
+    std::vector<std::string> flags;         // optional flags vc uses that the compiler accepts
+    std::string key;                        // hash of everything above
+
+    // Target and compiler release packages built with it share an ABI with
+    std::string abi() const;
+    bool supports(const std::string& flag) const;
+};
+
+// Fingerprint of a compiler named as in cproject.toml (a path or a PATH lookup)
+const CompilerFingerprint& compiler_fingerprint(const std::string& compiler);
+
+// cmd tagged with the fingerprint of compiler, as build caches record it in
+// their .cmd files: the same command run by a different compiler is stale
+std::string fingerprinted_command(const std::string& compiler, const std::string& cmd);
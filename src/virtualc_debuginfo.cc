@@ -0,0 +1,130 @@
+#include "virtualc_debuginfo.h"
+#include "virtualc_compiler.h"
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+// ELF object types worth splitting; relocatable objects and archives are left alone
+const unsigned char ET_EXEC_TYPE = 2;
+const unsigned char ET_DYN_TYPE = 3;
+
+std::string required_tool(const std::string& name) {
+    std::string path = find_in_path(name);
+    if (path.empty()) {
+        static std::once_flag warned;
+        std::call_once(warned, [&]() {
+            std::cerr << "Warning: " << name << " not found; debug info stays in the binaries." << std::endl;
+        });
+    }
+    return path;
+}
+
+// Executable or shared library, from the ELF header
+bool is_linked_elf(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    unsigned char header[18];
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+    if (header[0] != 0x7f || header[1] != 'E' || header[2] != 'L' || header[3] != 'F') return false;
+    // e_type follows the 16-byte ident in the byte order it names
+    unsigned char type = header[5] == 2 ? header[17] : header[16];
+    return type == ET_EXEC_TYPE || type == ET_DYN_TYPE;
+}
+
+bool is_current(const fs::path& debug_file, const fs::path& binary) {
+    std::error_code ec;
+    auto debug_time = fs::last_write_time(debug_file, ec);
+    if (ec) return false;
+    auto binary_time = fs::last_write_time(binary, ec);
+    return !ec && debug_time >= binary_time;
+}
+
+} // namespace
+
+// Whether the active profile of toml_file sets debug_info = "split"
+bool split_debug_info(const fs::path& toml_file) {
+    return get_profile_setting(toml_file, "debug_info", "") == "split";
+}
+
+// Compile and link flags of a split debug build: -g, a build-id, and -gz and
+// (with split_dwarf) -gsplit-dwarf where the compiler takes them
+std::vector<std::string> split_debug_flags(const std::string& compiler, bool split_dwarf) {
+    const CompilerFingerprint& fingerprint = compiler_fingerprint(compiler);
+    std::vector<std::string> flags = {"-g"};
+    if (split_dwarf && fingerprint.supports("-gsplit-dwarf")) flags.push_back("-gsplit-dwarf");
+    if (fingerprint.supports("-gz")) flags.push_back("-gz");
+    flags.push_back("-Wl,--build-id");
+    return flags;
+}
+
+// .dwo files a one-step compile and link into output left next to it
+std::vector<fs::path> linked_dwo_files(const fs::path& output) {
+    std::vector<fs::path> files;
+    std::string prefix = output.filename().string() + "-";
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(output.parent_path(), ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind(prefix, 0) == 0 && entry.path().extension() == ".dwo") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Move the debug info of binary into binary.debug, package dwo_files into
+// binary.dwp and strip binary, linking it to binary.debug; nothing to do
+// while binary.debug is as new as binary. Returns false if a tool failed
+bool separate_debug_info(const fs::path& binary, const std::vector<fs::path>& dwo_files) {
+    fs::path debug_file = binary.string() + ".debug";
+    fs::path dwp_file = binary.string() + ".dwp";
+    if (is_current(debug_file, binary)) return true;
+    std::string objcopy = required_tool("objcopy");
+    if (objcopy.empty()) return false;
+
+    // Split DWARF units are packaged first: the stripped binary no longer names them
+    std::error_code ec;
+    fs::remove(dwp_file, ec);
+    if (!dwo_files.empty()) {
+        std::string dwp = required_tool("dwp");
+        std::string cmd = shell_quote(dwp) + " -o " + shell_quote(dwp_file.string());
+        for (const auto& dwo : dwo_files) cmd += " " + shell_quote(dwo.string());
+        if (dwp.empty() || std::system(cmd.c_str()) != 0) {
+            std::cerr << "Warning: Could not package split DWARF of " << binary.filename().string()
+                      << "; debuggers still find the .dwo files." << std::endl;
+        }
+    }
+
+    std::string quoted = shell_quote(binary.string());
+    std::string keep = shell_quote(objcopy) + " --only-keep-debug " + quoted + " " + shell_quote(debug_file.string());
+    std::string strip = shell_quote(objcopy) + " --strip-unneeded --add-gnu-debuglink=" +
+                        shell_quote(debug_file.string()) + " " + quoted;
+    if (std::system(keep.c_str()) != 0 || std::system(strip.c_str()) != 0) {
+        std::cerr << "Warning: Could not split the debug info of " << binary.string() << std::endl;
+        fs::remove(debug_file, ec);
+        return false;
+    }
+    // Stamped with the stripped binary's time, so only a relink splits again
+    fs::last_write_time(debug_file, fs::last_write_time(binary, ec), ec);
+    return true;
+}
+
+// separate_debug_info for every ELF executable and shared library under
+// prefix; returns how many were split
+size_t separate_installed_debug_info(const fs::path& prefix) {
+    std::vector<fs::path> binaries;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(prefix, fs::directory_options::skip_permission_denied, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        // Versioned .so names are symlinks to one file; split that file once
+        if (it->is_symlink(ec) || !it->is_regular_file(ec)) continue;
+        std::string extension = it->path().extension().string();
+        if (extension == ".debug" || extension == ".dwp") continue;
+        if (is_linked_elf(it->path())) binaries.push_back(it->path());
+    }
+
+    std::atomic<size_t> split{0};
+    parallel_for(binaries.size(), [&](size_t i) {
+        if (separate_debug_info(binaries[i])) split++;
+    });
+    return split;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Whether the active profile of toml_file sets debug_info = "split"
+bool split_debug_info(const fs::path& toml_file);
+
+// Compile and link flags of a split debug build: -g, a build-id, and -gz and
+// (with split_dwarf) -gsplit-dwarf where the compiler takes them
+std::vector<std::string> split_debug_flags(const std::string& compiler, bool split_dwarf = true);
+
+// .dwo files a one-step compile and link into output left next to it
+std::vector<fs::path> linked_dwo_files(const fs::path& output);
+
+// Move the debug info of binary into binary.debug, package dwo_files into
+// binary.dwp and strip binary, linking it to binary.debug; nothing to do
+// while binary.debug is as new as binary. Returns false if a tool failed
+bool separate_debug_info(const fs::path& binary, const std::vector<fs::path>& dwo_files = {});
+
+// separate_debug_info for every ELF executable and shared library under
+// prefix; returns how many were split
+size_t separate_installed_debug_info(const fs::path& prefix);
@@ -0,0 +1,215 @@
+#include "virtualc_dedupe.h"
+#include "virtualc_hash.h"
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <map>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct FileInfo {
+    fs::path path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    nlink_t nlink;
+    std::string hash;
+};
+
+// Find every .venv directory below root without descending into them
+std::vector<fs::path> find_venvs(const fs::path& root) {
+    std::vector<fs::path> venvs;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (!it->is_directory(ec) || it->is_symlink(ec)) continue;
+        std::string name = it->path().filename().string();
+        if (name == ".venv") {
+            venvs.push_back(it->path());
+            it.disable_recursion_pending();
+        } else if (name == ".git") {
+            it.disable_recursion_pending();
+        }
+    }
+    return venvs;
+}
+
+// List regular files of one .venv, skipping vc's own state
+std::vector<FileInfo> list_venv_files(const fs::path& venv) {
+    std::vector<FileInfo> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(venv, fs::directory_options::skip_permission_denied, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (it->is_directory(ec) && it->path().filename() == ".vc" && it->path().parent_path() == venv) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        struct stat st;
+        if (lstat(it->path().c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) continue;
+        files.push_back({it->path(), st.st_dev, st.st_ino, st.st_size, st.st_mode, st.st_uid, st.st_gid, st.st_nlink, ""});
+    }
+    return files;
+}
+
+// Byte-compare two files so a hash collision can never merge different contents
+bool same_contents(const fs::path& a, const fs::path& b, size_t size) {
+    int fa = open(a.c_str(), O_RDONLY | O_CLOEXEC);
+    int fb = open(b.c_str(), O_RDONLY | O_CLOEXEC);
+    bool same = false;
+    if (fa >= 0 && fb >= 0) {
+        void* ma = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fa, 0);
+        void* mb = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fb, 0);
+        if (ma != MAP_FAILED && mb != MAP_FAILED) {
+            same = memcmp(ma, mb, size) == 0;
+        }
+        if (ma != MAP_FAILED) munmap(ma, size);
+        if (mb != MAP_FAILED) munmap(mb, size);
+    }
+    if (fa >= 0) close(fa);
+    if (fb >= 0) close(fb);
+    return same;
+}
+
+// Atomically replace duplicate with a hardlink to (or reflink of) original
+bool replace_with_link(const fs::path& original, const fs::path& duplicate, bool reflink) {
+    fs::path tmp = duplicate;
+    tmp += ".vcdedupe." + std::to_string(getpid());
+
+    if (reflink) {
+        int src = open(original.c_str(), O_RDONLY | O_CLOEXEC);
+        if (src < 0) return false;
+        struct stat st;
+        fstat(src, &st);
+        int dst = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+        if (dst < 0) {
+            close(src);
+            return false;
+        }
+        bool ok = ioctl(dst, FICLONE, src) == 0;
+        close(src);
+        close(dst);
+        if (!ok) {
+            unlink(tmp.c_str());
+            return false;
+        }
+    } else if (link(original.c_str(), tmp.c_str()) != 0) {
+        return false;
+    }
+
+    if (rename(tmp.c_str(), duplicate.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string format_bytes(uintmax_t bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1024;
+        unit++;
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.1f %s", value, units[unit]);
+    return buffer;
+}
+
+} // namespace
+
+// Implement dedupe subcommand
+int dedupe_main(int argc, char** argv) {
+    cxxopts::Options options("vc dedupe", "Hardlink identical files across .venv trees");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("n,dry-run", "Only report what would be reclaimed")
+        ("reflink", "Use copy-on-write reflinks instead of hardlinks")
+        ("root", "Directory to scan for projects", cxxopts::value<std::string>()->default_value("."));
+    options.parse_positional({"root"});
+    options.positional_help("[ROOT]");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+    bool dry_run = result.count("dry-run") > 0;
+    bool reflink = result.count("reflink") > 0;
+
+    // 1. Find and list every .venv in parallel
+    fs::path root = fs::absolute(result["root"].as<std::string>());
+    std::vector<fs::path> venvs = find_venvs(root);
+    std::vector<std::vector<FileInfo>> listings(venvs.size());
+    parallel_for(venvs.size(), [&](size_t i) {
+        listings[i] = list_venv_files(venvs[i]);
+    });
+
+    // 2. Group by device and size, keeping one path per inode; only same-size files can match
+    std::map<std::pair<dev_t, off_t>, std::vector<FileInfo>> by_size;
+    std::set<std::pair<dev_t, ino_t>> seen_inodes;
+    size_t total_files = 0;
+    for (auto& listing : listings) {
+        for (auto& file : listing) {
+            total_files++;
+            if (!seen_inodes.insert({file.dev, file.ino}).second) continue;
+            by_size[{file.dev, file.size}].push_back(std::move(file));
+        }
+    }
+
+    std::vector<FileInfo*> candidates;
+    for (auto& [key, files] : by_size) {
+        if (files.size() < 2) continue;
+        for (auto& file : files) candidates.push_back(&file);
+    }
+
+    // 3. Hash the candidates across all cores
+    parallel_for(candidates.size(), [&](size_t i) {
+        candidates[i]->hash = hash_file(candidates[i]->path);
+    });
+
+    // 4. Link duplicates to the first file with the same contents and metadata
+    uintmax_t reclaimed = 0;
+    size_t linked = 0;
+    size_t failed = 0;
+    for (auto& [key, files] : by_size) {
+        if (files.size() < 2) continue;
+        std::map<std::string, FileInfo*> originals;
+        for (auto& file : files) {
+            if (file.hash.empty()) continue;
+            std::string group = file.hash + ":" + std::to_string(file.mode) + ":" + std::to_string(file.uid) + ":" +
+                                std::to_string(file.gid);
+            auto [it, inserted] = originals.emplace(group, &file);
+            if (inserted) continue;
+
+            const FileInfo& original = *it->second;
+            if (!same_contents(original.path, file.path, static_cast<size_t>(file.size))) continue;
+
+            // Space is only freed once no other link keeps the duplicate's data alive
+            uintmax_t freed = (reflink || file.nlink == 1) ? static_cast<uintmax_t>(file.size) : 0;
+            if (dry_run) {
+                std::cout << "would link " << file.path.string() << " -> " << original.path.string() << std::endl;
+            } else if (!replace_with_link(original.path, file.path, reflink)) {
+                std::cerr << "Warning: Failed to link " << file.path << ": " << strerror(errno) << std::endl;
+                failed++;
+                continue;
+            }
+            reclaimed += freed;
+            linked++;
+        }
+    }
+
+    std::cout << "Scanned " << venvs.size() << " .venv tree(s), " << total_files << " file(s)." << std::endl;
+    std::cout << (dry_run ? "Would link " : "Linked ") << linked << " duplicate file(s), "
+              << (dry_run ? "reclaiming " : "reclaimed ") << format_bytes(reclaimed) << "." << std::endl;
+    return failed ? 1 : 0;
+}
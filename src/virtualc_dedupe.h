@@ -0,0 +1,6 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Replace identical files across many projects' .venv trees with hardlinks or reflinks
+int dedupe_main(int argc, char** argv);
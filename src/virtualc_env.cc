@@ -0,0 +1,178 @@
+#include "virtualc_env.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Variables that are search paths and get prepended to the caller's value
+const std::set<std::string> PATH_VARIABLES = {"CPATH", "LIBRARY_PATH", "LD_LIBRARY_PATH", "PKG_CONFIG_PATH"};
+
+// Utility: join values with a separator
+std::string join(const std::vector<std::string>& values, const std::string& sep) {
+    std::string out;
+    for (const auto& value : values) {
+        if (value.empty()) continue;
+        if (!out.empty()) out += sep;
+        out += value;
+    }
+    return out;
+}
+
+// Utility: append a value once, keeping first-seen order
+void push_unique(std::vector<std::string>& values, const std::string& value) {
+    if (std::find(values.begin(), values.end(), value) == values.end()) values.push_back(value);
+}
+
+// Identity of a file as stat sees it: inode, nanosecond mtime and size, so an edit
+// within the same second as the cached activation still changes it
+std::string stat_stamp(const fs::path& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return "";
+    long long mtime_ns = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return path.string() + ":" + std::to_string(st.st_ino) + ":" + std::to_string(mtime_ns) + ":" +
+           std::to_string(st.st_size) + "\n";
+}
+
+// Signature of everything the environment is derived from
+std::string env_signature(const fs::path& root) {
+    std::string signature;
+    for (const auto& path : {root / "cproject.toml", root / ".libpath", root / ".venv"}) {
+        signature += stat_stamp(path);
+    }
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(root / ".venv", ec)) {
+        signature += stat_stamp(entry.path() / "lib" / "pkgconfig");
+    }
+    return hash_string(signature);
+}
+
+// Compute the environment variables for the project
+std::vector<std::pair<std::string, std::string>> compute_env(const fs::path& root) {
+    std::vector<std::string> includes, libpaths, pkgconfig_dirs;
+    for (const auto& entry : read_libpath_entries(root / ".libpath")) {
+        for (const auto& include : entry.includes) push_unique(includes, include);
+        for (const auto& libpath : entry.libpaths) push_unique(libpaths, libpath);
+    }
+
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(root / ".venv", ec)) {
+        fs::path pc_dir = entry.path() / "lib" / "pkgconfig";
+        if (fs::is_directory(pc_dir, ec)) push_unique(pkgconfig_dirs, pc_dir.string());
+    }
+    std::sort(pkgconfig_dirs.begin(), pkgconfig_dirs.end());
+
+    std::vector<std::string> rpath_flags;
+    if (!libpaths.empty()) rpath_flags.push_back("-Wl,--enable-new-dtags");
+    for (const auto& libpath : libpaths) rpath_flags.push_back("-Wl,-rpath," + libpath);
+
+    std::string cc, cxx;
+    derive_c_cxx(get_compiler_path(root / "cproject.toml"), cc, cxx);
+
+    return {
+        {"VIRTUALC_PROJECT", root.string()},
+        {"CPATH", join(includes, ":")},
+        {"LIBRARY_PATH", join(libpaths, ":")},
+        {"LD_LIBRARY_PATH", join(libpaths, ":")},
+        {"PKG_CONFIG_PATH", join(pkgconfig_dirs, ":")},
+        {"VC_LDFLAGS", join(rpath_flags, " ")},
+        {"CC", cc},
+        {"CXX", cxx},
+    };
+}
+
+// Load the cached environment, regenerating it when its inputs changed
+std::vector<std::pair<std::string, std::string>> load_env(const fs::path& root) {
+    fs::path cache = vc_state_dir(root) / "env.cache";
+    std::string signature = env_signature(root);
+
+    std::vector<std::pair<std::string, std::string>> vars;
+    std::ifstream in(cache);
+    std::string line;
+    if (std::getline(in, line) && line == signature) {
+        while (std::getline(in, line)) {
+            size_t eq = line.find('=');
+            if (eq != std::string::npos) vars.emplace_back(line.substr(0, eq), line.substr(eq + 1));
+        }
+        return vars;
+    }
+
+    vars = compute_env(root);
+    std::string content = signature + "\n";
+    for (const auto& var : vars) content += var.first + "=" + var.second + "\n";
+    create_file(cache, content);
+    return vars;
+}
+
+// Locate the project root by walking up to the nearest cproject.toml
+std::optional<fs::path> find_project_root() {
+    fs::path dir = fs::current_path();
+    while (true) {
+        if (fs::exists(dir / "cproject.toml")) return dir;
+        if (dir == dir.root_path() || dir.parent_path() == dir) return std::nullopt;
+        dir = dir.parent_path();
+    }
+}
+
+} // namespace
+
+// Implement env subcommand
+int env_main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    std::optional<fs::path> root = find_project_root();
+    if (!root) {
+        std::cerr << "Error: Project not initialized (cproject.toml not found)." << std::endl;
+        return 1;
+    }
+
+    auto vars = load_env(*root);
+
+    std::cout << "# Generated by vc env. Activate with: eval \"$(vc env)\"\n";
+    std::cout << "vc_deactivate() {\n";
+    for (const auto& var : vars) {
+        std::cout << "    if [ -n \"${_VC_OLD_" << var.first << "+x}\" ]; then export " << var.first
+                  << "=\"$_VC_OLD_" << var.first << "\"; unset _VC_OLD_" << var.first
+                  << "; else unset " << var.first << "; fi\n";
+    }
+    std::cout << "    unset -f vc_deactivate\n";
+    std::cout << "}\n";
+    for (const auto& var : vars) {
+        const std::string& name = var.first;
+        std::cout << "if [ -n \"${" << name << "+x}\" ]; then _VC_OLD_" << name << "=\"$" << name << "\"; fi\n";
+        if (var.second.empty()) continue;
+        if (PATH_VARIABLES.count(name)) {
+            std::cout << "export " << name << "=" << shell_quote(var.second) << "\"${" << name << ":+:$" << name << "}\"\n";
+        } else {
+            std::cout << "export " << name << "=" << shell_quote(var.second) << "\n";
+        }
+    }
+    return 0;
+}
+
+// Implement shell subcommand
+int shell_main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    std::optional<fs::path> root = find_project_root();
+    if (!root) {
+        std::cerr << "Error: Project not initialized (cproject.toml not found)." << std::endl;
+        return 1;
+    }
+
+    for (const auto& var : load_env(*root)) {
+        if (var.second.empty()) continue;
+        const char* old_value = getenv(var.first.c_str());
+        std::string value = var.second;
+        if (PATH_VARIABLES.count(var.first) && old_value && *old_value) {
+            value += ":" + std::string(old_value);
+        }
+        setenv(var.first.c_str(), value.c_str(), 1);
+    }
+
+    const char* shell = getenv("SHELL");
+    if (!shell || !*shell) shell = "/bin/sh";
+    std::cout << "Entering vc environment for " << *root << " (exit to leave)" << std::endl;
+    execl(shell, shell, "-i", static_cast<char*>(nullptr));
+    std::cerr << "Error: Failed to start shell '" << shell << "': " << strerror(errno) << std::endl;
+    return 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Print a shell activation script for the project environment
+int env_main(int argc, char** argv);
+
+// Start an interactive shell inside the project environment
+int shell_main(int argc, char** argv);
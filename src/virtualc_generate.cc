@@ -0,0 +1,188 @@
+#include "virtualc_generate.h"
+#include "virtualc_compiler.h"
+
+namespace {
+
+// Utility: escape a path for use in a ninja build statement
+std::string ninja_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '$' || c == ' ' || c == ':' || c == '\n') out += '$';
+        out += c;
+    }
+    return out;
+}
+
+// Utility: escape a variable value for ninja
+std::string ninja_value_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '$') out += '$';
+        out += c;
+    }
+    return out;
+}
+
+// Utility: join arguments into a shell command line
+std::string join_args(const std::vector<std::string>& args) {
+    std::string out;
+    for (const auto& arg : args) {
+        if (!out.empty()) out += " ";
+        out += shell_quote(arg);
+    }
+    return out;
+}
+
+// Write compile_commands.json with one entry per source
+void write_compile_commands(const fs::path& root, const std::string& compiler,
+                            const std::vector<std::string>& compile_args, const std::vector<fs::path>& sources) {
+    std::ostringstream out;
+    out << "[\n";
+    for (size_t i = 0; i < sources.size(); ++i) {
+        std::string rel = fs::relative(sources[i], root).string();
+        std::string object = "build/" + rel + ".o";
+
+        std::vector<std::string> arguments = {compiler};
+        arguments.insert(arguments.end(), compile_args.begin(), compile_args.end());
+        arguments.push_back("-c");
+        arguments.push_back(sources[i].string());
+        arguments.push_back("-o");
+        arguments.push_back(object);
+
+        out << "  {\n";
+        out << "    \"directory\": \"" << json_escape(root.string()) << "\",\n";
+        out << "    \"arguments\": [";
+        for (size_t j = 0; j < arguments.size(); ++j) {
+            if (j) out << ", ";
+            out << "\"" << json_escape(arguments[j]) << "\"";
+        }
+        out << "],\n";
+        out << "    \"file\": \"" << json_escape(sources[i].string()) << "\",\n";
+        out << "    \"output\": \"" << json_escape(object) << "\"\n";
+        out << "  }" << (i + 1 < sources.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    create_file(root / "compile_commands.json", out.str());
+}
+
+// Write build.ninja building every source into its own program, as vc run does
+void write_build_ninja(const fs::path& root, const fs::path& tomlfile, const fs::path& libpath, const std::string& compiler,
+                       const std::vector<std::string>& compile_args, const std::vector<std::string>& link_args,
+                       const std::vector<fs::path>& sources, const std::vector<fs::path>& source_dirs) {
+    std::ostringstream out;
+    out << "# Generated by vc generate. Do not edit; rerun vc generate instead.\n";
+    out << "ninja_required_version = 1.3\n\n";
+    out << "cc = " << shell_quote(compiler) << "\n";
+    out << "cflags = " << join_args(compile_args) << "\n";
+    out << "ldflags = " << join_args(link_args) << "\n\n";
+
+    out << "rule cc\n";
+    out << "  command = $cc -MD -MF $out.d $cflags -c $in -o $out\n";
+    out << "  description = CC $out\n";
+    out << "  depfile = $out.d\n";
+    out << "  deps = gcc\n\n";
+
+    out << "rule link\n";
+    out << "  command = $cc $in -o $out $ldflags $rpath\n";
+    out << "  description = LINK $out\n\n";
+
+    out << "rule regen\n";
+    out << "  command = vc generate --force\n";
+    out << "  description = Regenerating build.ninja\n";
+    out << "  generator = 1\n\n";
+
+    // A directory's mtime changes when a file is added to it, so new sources regenerate too
+    out << "build build.ninja compile_commands.json: regen cproject.toml .libpath";
+    for (const auto& dir : source_dirs) out << " " << ninja_escape(fs::relative(dir, root).string());
+    out << "\n\n";
+
+    std::vector<std::string> programs;
+    for (const auto& source : sources) {
+        fs::path rel = fs::relative(source, root);
+        std::string object = "build/" + rel.string() + ".o";
+        std::string program = "build/" + (rel.parent_path() / rel.stem()).string();
+
+        out << "build " << ninja_escape(object) << ": cc " << ninja_escape(rel.string()) << "\n";
+        out << "build " << ninja_escape(program) << ": link " << ninja_escape(object) << "\n";
+        std::vector<std::string> rpath_args = build_rpath_args(libpath, tomlfile, (root / program).parent_path());
+        if (!rpath_args.empty()) {
+            out << "  rpath = " << ninja_value_escape(join_args(rpath_args)) << "\n";
+        }
+        programs.push_back(ninja_escape(program));
+    }
+
+    if (!programs.empty()) {
+        out << "\ndefault";
+        for (const auto& program : programs) out << " " << program;
+        out << "\n";
+    }
+    create_file(root / "build.ninja", out.str());
+}
+
+} // namespace
+
+// Implement generate subcommand
+int generate_main(int argc, char** argv) {
+    cxxopts::Options options("vc generate", "Generate compile_commands.json and build.ninja");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("f,force", "Regenerate even if inputs are unchanged");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    fs::path root = fs::current_path();
+    fs::path tomlfile = root / "cproject.toml";
+    fs::path libpath = root / ".libpath";
+
+    if (!fs::exists(tomlfile)) {
+        std::cerr << "Error: Project not initialized (cproject.toml not found)." << std::endl;
+        return 1;
+    }
+    // build.ninja lists .libpath as an input, and ninja refuses inputs that do not exist
+    if (!fs::exists(libpath)) {
+        std::ofstream(libpath, std::ios::app);
+    }
+
+    // Resolve compiler and flags exactly as run_main does
+    std::string compiler = get_compiler_path(tomlfile);
+    std::vector<std::string> compile_args, link_args;
+    compile_args = split_flags(get_profile_setting(tomlfile, "cflags", ""));
+    split_compiler_args(build_compiler_args(libpath), compile_args, link_args);
+    std::vector<std::string> ldflags = split_flags(get_profile_setting(tomlfile, "ldflags", ""));
+    link_args.insert(link_args.end(), ldflags.begin(), ldflags.end());
+    std::vector<fs::path> source_dirs;
+    std::vector<fs::path> sources = collect_sources(root, &source_dirs);
+
+    // Signature of every input; the outputs only change when it does
+    std::string signature = compiler + "\n" + compiler_fingerprint(compiler).key + "\n";
+    for (const auto& arg : compile_args) signature += arg + "\n";
+    for (const auto& arg : link_args) signature += arg + "\n";
+    for (const auto& source : sources) signature += source.string() + "\n";
+    for (const auto& dir : source_dirs) signature += "dir " + dir.string() + "\n";
+    signature += get_project_setting(tomlfile, "rpath", "origin") + "\n";
+    signature += get_project_flag(tomlfile, "bindnow", false) ? "bindnow\n" : "\n";
+    signature = hash_string(signature);
+
+    fs::path stamp = vc_state_dir(root) / "generate.stamp";
+    bool outputs_exist = fs::exists(root / "compile_commands.json") && fs::exists(root / "build.ninja");
+    if (!result.count("force") && outputs_exist && fs::exists(stamp)) {
+        std::ifstream in(stamp);
+        std::string previous;
+        std::getline(in, previous);
+        if (previous == signature) {
+            std::cout << "Build files are up to date." << std::endl;
+            return 0;
+        }
+    }
+
+    write_compile_commands(root, compiler, compile_args, sources);
+    write_build_ninja(root, tomlfile, libpath, compiler, compile_args, link_args, sources, source_dirs);
+    create_file(stamp, signature + "\n");
+
+    std::cout << "Generated compile_commands.json and build.ninja for " << sources.size() << " source(s)." << std::endl;
+    return 0;
+}
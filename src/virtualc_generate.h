@@ -0,0 +1,6 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Generate compile_commands.json and build.ninja for the project
+int generate_main(int argc, char** argv);
@@ -0,0 +1,186 @@
+#include "virtualc_hash.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint64_t PRIME64_1 = 11400714785074694791ULL;
+const uint64_t PRIME64_2 = 14029467366897019727ULL;
+const uint64_t PRIME64_3 = 1609587929392839161ULL;
+const uint64_t PRIME64_4 = 9650029242287828579ULL;
+const uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xxh64_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+std::string to_hex(uint64_t value) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+// Cache key of a file as it is on disk now, or empty if it cannot be stat'ed
+std::string stat_key(const fs::path& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return "";
+    return std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" +
+           std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec) + ":" +
+           std::to_string(st.st_size);
+}
+
+} // namespace
+
+// XXH64 of a memory buffer. The main loop is scalar, but its four independent
+// accumulators have no dependency on each other, so the CPU overlaps their
+// multiplies; that instruction-level parallelism makes it several times faster than FNV.
+uint64_t xxh64(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    uint64_t h;
+
+    if (length >= 32) {
+        const unsigned char* limit = end - 32;
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        do {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += static_cast<uint64_t>(length);
+
+    while (p + 8 <= end) {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Hash of a file's contents (XXH64 of a read-only mapping) as hex
+std::string hash_file(const fs::path& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return "";
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return "";
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return to_hex(xxh64(nullptr, 0));
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return "";
+    madvise(map, size, MADV_SEQUENTIAL);
+    uint64_t hash = xxh64(map, size);
+    munmap(map, size);
+    return to_hex(hash);
+}
+
+HashCache::HashCache(const fs::path& cache_file) : cache_file_(cache_file) {
+    // "<key> <hash> <path>" per line; the path may contain spaces
+    std::ifstream in(cache_file_);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t first = line.find(' ');
+        size_t second = first == std::string::npos ? first : line.find(' ', first + 1);
+        if (second == std::string::npos) {
+            dirty_ = true;  // entry without a path from an older vc; dropped on save
+            continue;
+        }
+        entries_[line.substr(0, first)] = {line.substr(first + 1, second - first - 1), line.substr(second + 1)};
+    }
+}
+
+// Hash a file, consulting the cache first; safe to call from several threads
+std::string HashCache::hash(const fs::path& path) {
+    std::string key = stat_key(path);
+    if (key.empty()) return "";
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) return it->second.first;
+    }
+
+    std::string hash = hash_file(path);
+    if (!hash.empty()) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        entries_[key] = {hash, path.string()};
+        dirty_ = true;
+    }
+    return hash;
+}
+
+// Write the cache back if anything changed, dropping entries for files that
+// were deleted or have changed since they were hashed
+void HashCache::save() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!dirty_) return;
+    std::string content;
+    for (const auto& [key, entry] : entries_) {
+        if (stat_key(entry.second) != key) continue;
+        content += key + " " + entry.first + " " + entry.second + "\n";
+    }
+    write_file_atomic(cache_file_, content);
+    dirty_ = false;
+}
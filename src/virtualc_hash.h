@@ -0,0 +1,30 @@
+#pragma once
+
+#include "virtualc_common.h"
+#include <mutex>
+#include <unordered_map>
+
+// XXH64 of a memory buffer
+uint64_t xxh64(const void* data, size_t length, uint64_t seed = 0);
+
+// Hash of a file's contents (XXH64 of a read-only mapping) as hex
+std::string hash_file(const fs::path& path);
+
+// Content hashes cached by device, inode, mtime and size so unchanged files are not reread
+class HashCache {
+public:
+    explicit HashCache(const fs::path& cache_file);
+
+    // Hash a file, consulting the cache first; safe to call from several threads
+    std::string hash(const fs::path& path);
+
+    // Write the cache back if anything changed, dropping entries for files that
+    // were deleted or have changed since they were hashed
+    void save();
+
+private:
+    fs::path cache_file_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::pair<std::string, std::string>> entries_;  // key -> hash, path
+    bool dirty_ = false;
+};
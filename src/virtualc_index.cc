@@ -0,0 +1,286 @@
+#include "virtualc_index.h"
+#include "virtualc_hash.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char* INDEX_MAGIC = "VCINDEX1";
+const char FIELD_SEP = '\t';
+const char PARAM_SEP = '\x1f';
+
+// Utility: split on a single character
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t pos = s.find(sep, start);
+        parts.push_back(s.substr(start, pos - start));
+        if (pos == std::string::npos) break;
+        start = pos + 1;
+    }
+    return parts;
+}
+
+// Utility: strip characters that would break the line format
+std::string clean_field(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c != '\n' && c != '\r' && c != FIELD_SEP && c != PARAM_SEP) out += c;
+    }
+    return out;
+}
+
+// Size and mtime of every install script and .morevariable under libs, hashed;
+// changes whenever an edit, addition or removal would change the index
+std::string libs_fingerprint(const fs::path& libs) {
+    std::vector<std::string> stamps;
+    std::error_code ec;
+    for (const auto& dir : fs::directory_iterator(libs, ec)) {
+        if (!dir.is_directory(ec)) continue;
+        for (const auto& file : fs::directory_iterator(dir.path(), ec)) {
+            std::string filename = file.path().filename().string();
+            bool script = filename.rfind("install_", 0) == 0 && file.path().extension() == ".sh";
+            if (!script && filename != ".morevariable") continue;
+            struct stat st;
+            if (stat(file.path().c_str(), &st) != 0) continue;
+            stamps.push_back(file.path().lexically_relative(libs).string() + " " + std::to_string(st.st_size) + " " +
+                             std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec));
+        }
+    }
+    std::sort(stamps.begin(), stamps.end());
+    std::string data;
+    for (const auto& stamp : stamps) data += stamp + "\n";
+    return hash_string(data);
+}
+
+// Fuzzy subsequence score: lower is better, -1 if query is not a subsequence of name
+int fuzzy_score(const std::string& query, const std::string& name) {
+    size_t pos = 0;
+    int gaps = 0;
+    for (char c : query) {
+        size_t found = name.find(c, pos);
+        if (found == std::string::npos) return -1;
+        gaps += static_cast<int>(found - pos);
+        pos = found + 1;
+    }
+    return gaps + static_cast<int>(name.size() - pos);
+}
+
+} // namespace
+
+// Scan a libs directory and write a sorted index of its install scripts
+bool build_script_index(const fs::path& libs, const fs::path& index_file) {
+    std::vector<ScriptIndexEntry> entries;
+    std::error_code ec;
+    for (const auto& dir : fs::directory_iterator(libs, ec)) {
+        if (!dir.is_directory(ec)) continue;
+        for (const auto& file : fs::directory_iterator(dir.path(), ec)) {
+            std::string filename = file.path().filename().string();
+            if (filename.rfind("install_", 0) != 0 || file.path().extension() != ".sh") continue;
+
+            ScriptIndexEntry entry;
+            entry.name = to_lowercase(filename.substr(8, filename.size() - 8 - 3));
+            entry.script = fs::relative(file.path(), libs).string();
+            entry.hash = hash_file(file.path());
+            std::ifstream morevariable(dir.path() / ".morevariable");
+            std::string description;
+            while (std::getline(morevariable, description)) {
+                if (!description.empty()) entry.params.push_back(clean_field(description));
+            }
+            entries.push_back(entry);
+        }
+    }
+    if (ec) return false;
+
+    std::sort(entries.begin(), entries.end(), [](const ScriptIndexEntry& a, const ScriptIndexEntry& b) {
+        return a.name < b.name;
+    });
+
+    std::string content = std::string(INDEX_MAGIC) + " " + std::to_string(entries.size()) + " " +
+                          libs_fingerprint(libs) + "\n";
+    for (const auto& entry : entries) {
+        content += entry.name + FIELD_SEP + entry.script + FIELD_SEP + entry.hash + FIELD_SEP;
+        for (size_t i = 0; i < entry.params.size(); ++i) {
+            if (i) content += PARAM_SEP;
+            content += entry.params[i];
+        }
+        content += "\n";
+    }
+    write_file_atomic(index_file, content);
+    return true;
+}
+
+ScriptIndex::ScriptIndex(const fs::path& index_file) {
+    int fd = open(index_file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            data_ = static_cast<const char*>(map);
+            size_ = static_cast<size_t>(st.st_size);
+        }
+    }
+    close(fd);
+
+    // Reject anything that is not an index we wrote
+    size_t magic_len = strlen(INDEX_MAGIC);
+    if (data_ && (size_ < magic_len || memcmp(data_, INDEX_MAGIC, magic_len) != 0)) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+    if (data_) body_ = line_end(0) + 1;
+}
+
+ScriptIndex::~ScriptIndex() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+}
+
+size_t ScriptIndex::line_start(size_t pos) const {
+    while (pos > body_ && data_[pos - 1] != '\n') pos--;
+    return pos;
+}
+
+size_t ScriptIndex::line_end(size_t pos) const {
+    const void* nl = memchr(data_ + pos, '\n', size_ - pos);
+    return nl ? static_cast<size_t>(static_cast<const char*>(nl) - data_) : size_;
+}
+
+std::string_view ScriptIndex::name_at(size_t start) const {
+    size_t end = line_end(start);
+    const void* tab = memchr(data_ + start, FIELD_SEP, end - start);
+    size_t name_end = tab ? static_cast<size_t>(static_cast<const char*>(tab) - data_) : end;
+    return std::string_view(data_ + start, name_end - start);
+}
+
+ScriptIndexEntry ScriptIndex::parse_line(size_t start) const {
+    std::vector<std::string> fields = split(std::string(data_ + start, line_end(start) - start), FIELD_SEP);
+    ScriptIndexEntry entry;
+    if (fields.size() > 0) entry.name = fields[0];
+    if (fields.size() > 1) entry.script = fields[1];
+    if (fields.size() > 2) entry.hash = fields[2];
+    if (fields.size() > 3 && !fields[3].empty()) entry.params = split(fields[3], PARAM_SEP);
+    return entry;
+}
+
+// Entries whose name starts with prefix, found by binary search over the sorted lines
+std::vector<ScriptIndexEntry> ScriptIndex::with_prefix(const std::string& prefix) const {
+    std::vector<ScriptIndexEntry> matches;
+    if (!data_) return matches;
+
+    // Find the first line whose name is >= prefix
+    size_t lo = body_, hi = size_;
+    while (lo < hi) {
+        size_t start = line_start(lo + (hi - lo) / 2);
+        if (name_at(start) < prefix) {
+            lo = line_end(start) + 1;
+        } else {
+            hi = start;
+        }
+    }
+
+    for (size_t pos = lo; pos < size_; pos = line_end(pos) + 1) {
+        std::string_view name = name_at(pos);
+        if (name.substr(0, prefix.size()) != prefix) break;
+        matches.push_back(parse_line(pos));
+    }
+    return matches;
+}
+
+// Fingerprint of the scripts the index was built from, from its header line
+std::string ScriptIndex::fingerprint() const {
+    if (!data_) return "";
+    std::vector<std::string> fields = split(std::string(data_, line_end(0)), ' ');
+    return fields.size() > 2 ? fields[2] : "";
+}
+
+std::optional<ScriptIndexEntry> ScriptIndex::find(const std::string& name) const {
+    for (auto& entry : with_prefix(to_lowercase(name))) {
+        if (entry.name == to_lowercase(name)) return entry;
+    }
+    return std::nullopt;
+}
+
+std::vector<ScriptIndexEntry> ScriptIndex::all() const {
+    std::vector<ScriptIndexEntry> entries;
+    if (!data_) return entries;
+    for (size_t pos = body_; pos < size_; pos = line_end(pos) + 1) {
+        if (line_end(pos) > pos) entries.push_back(parse_line(pos));
+    }
+    return entries;
+}
+
+// Index used for lookups: libs_dir/.vcindex, or a cached one rebuilt when a script changes
+fs::path script_index_path() {
+    fs::path shipped = fs::path(libs_dir) / ".vcindex";
+    if (fs::exists(shipped)) return shipped;
+
+    // Trees installed without vc upgrade have no index; keep one in the user cache.
+    // Editing a script leaves the libs_dir mtime alone, so each file's stamp is compared
+    fs::path cached = vc_cache_dir() / "scripts.vcindex";
+    std::error_code ec;
+    if (!fs::is_directory(libs_dir, ec)) return cached;
+    if (ScriptIndex(cached).fingerprint() != libs_fingerprint(libs_dir)) {
+        fs::create_directories(cached.parent_path(), ec);
+        build_script_index(libs_dir, cached);
+    }
+    return cached;
+}
+
+// Implement search subcommand
+int search_main(int argc, char** argv) {
+    cxxopts::Options options("vc search", "Search available install scripts");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("query", "Library name, prefix or fuzzy pattern", cxxopts::value<std::string>()->default_value(""));
+    options.parse_positional({"query"});
+    options.positional_help("[QUERY]");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    ScriptIndex index(script_index_path());
+    if (!index.valid()) {
+        std::cerr << "Error: No script index available. Run 'vc upgrade' to install library scripts." << std::endl;
+        return 1;
+    }
+
+    std::string query = to_lowercase(result["query"].as<std::string>());
+    std::vector<ScriptIndexEntry> matches = index.with_prefix(query);
+
+    // Fall back to fuzzy subsequence matching when nothing starts with the query
+    if (matches.empty()) {
+        std::vector<std::pair<int, ScriptIndexEntry>> scored;
+        for (auto& entry : index.all()) {
+            int score = fuzzy_score(query, entry.name);
+            if (score >= 0) scored.emplace_back(score, entry);
+        }
+        std::stable_sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (auto& [score, entry] : scored) matches.push_back(entry);
+    }
+
+    if (matches.empty()) {
+        std::cout << "No install scripts match '" << query << "'." << std::endl;
+        return 1;
+    }
+    for (const auto& entry : matches) {
+        std::cout << entry.name;
+        if (!entry.params.empty()) {
+            std::cout << " (asks for: ";
+            for (size_t i = 0; i < entry.params.size(); ++i) {
+                if (i) std::cout << ", ";
+                std::cout << entry.params[i];
+            }
+            std::cout << ")";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// One install script listed in the script index
+struct ScriptIndexEntry {
+    std::string name;                 // lowercase library name
+    std::string script;               // script path relative to libs_dir
+    std::string hash;                 // content hash of the script
+    std::vector<std::string> params;  // .morevariable prompts, in order
+};
+
+// Scan a libs directory and write a sorted index of its install scripts
+bool build_script_index(const fs::path& libs, const fs::path& index_file);
+
+// Read-only view of a script index file, mapped into memory.
+// Lines are sorted by name so lookups are a binary search over the mapping.
+class ScriptIndex {
+public:
+    explicit ScriptIndex(const fs::path& index_file);
+    ~ScriptIndex();
+    ScriptIndex(const ScriptIndex&) = delete;
+    ScriptIndex& operator=(const ScriptIndex&) = delete;
+
+    bool valid() const { return data_ != nullptr; }
+    std::optional<ScriptIndexEntry> find(const std::string& name) const;
+    std::vector<ScriptIndexEntry> with_prefix(const std::string& prefix) const;
+    std::vector<ScriptIndexEntry> all() const;
+    // Fingerprint of the scripts the index was built from; empty for older indexes
+    std::string fingerprint() const;
+
+private:
+    size_t line_start(size_t pos) const;
+    size_t line_end(size_t pos) const;
+    std::string_view name_at(size_t start) const;
+    ScriptIndexEntry parse_line(size_t start) const;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t body_ = 0;  // offset of the first entry after the header line
+};
+
+// Index used for lookups: libs_dir/.vcindex, or a cached one rebuilt when a script changes
+fs::path script_index_path();
+
+// Search available install scripts
+int search_main(int argc, char** argv);
@@ -1,13 +1,170 @@
 #include "virtualc_install.h"
+#include "virtualc_lock.h"
+#include "virtualc_verify.h"
+#include "virtualc_scheduler.h"
+#include "virtualc_index.h"
+#include "virtualc_compiler.h"
+#include "virtualc_debuginfo.h"
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Checkpoints an install script can record in $VC_STAGE_DIR, in order
+static const char* INSTALL_STAGES[] = {"fetched", "configured", "built", "installed"};
+
+// Time between consecutive checkpoints the script recorded since started, from the marker mtimes
+static std::vector<std::pair<std::string, double>> stage_durations(const fs::path& stage_dir, const timespec& started) {
+    std::vector<std::pair<std::string, double>> stages;
+    double previous = started.tv_sec + started.tv_nsec / 1e9;
+    for (const char* stage : INSTALL_STAGES) {
+        struct stat st;
+        if (stat((stage_dir / stage).c_str(), &st) != 0) continue;
+        double reached = st.st_mtim.tv_sec + st.st_mtim.tv_nsec / 1e9;
+        if (reached < previous) continue;  // left over from an earlier attempt
+        stages.emplace_back(stage, reached - previous);
+        previous = reached;
+    }
+    return stages;
+}
+
+// GNU make jobserver shared by every script this process runs, so concurrent
+// installs split the cores between them instead of each using all of them
+static int jobserver_fds[2] = {-1, -1};
+
+static std::string jobserver_makeflags(unsigned jobs) {
+    static std::once_flag once;
+    static std::string makeflags;
+    std::call_once(once, [jobs]() {
+        makeflags = "-j" + std::to_string(jobs);
+        int fds[2];
+        if (jobs < 2 || pipe(fds) != 0) return;
+        // One token per job: vc takes one for each running script, standing in for
+        // the implicit token its top-level make holds, so K scripts still run N jobs
+        std::string tokens(jobs, '+');
+        if (write(fds[1], tokens.data(), tokens.size()) != static_cast<ssize_t>(tokens.size())) {
+            close(fds[0]);
+            close(fds[1]);
+            return;
+        }
+        jobserver_fds[0] = fds[0];
+        jobserver_fds[1] = fds[1];
+        makeflags += " --jobserver-auth=" + std::to_string(fds[0]) + "," + std::to_string(fds[1]);
+    });
+    return makeflags;
+}
+
+// Take a script's token from the jobserver, waiting while all are in use;
+// false when there is no jobserver
+static bool take_job_token() {
+    if (jobserver_fds[0] < 0) return false;
+    char token;
+    while (true) {
+        ssize_t n = read(jobserver_fds[0], &token, 1);
+        if (n == 1) return true;
+        if (n == 0 || (errno != EINTR && errno != EAGAIN)) return false;
+        // make may have switched the shared pipe to non-blocking
+        pollfd ready = {jobserver_fds[0], POLLIN, 0};
+        poll(&ready, 1, -1);
+    }
+}
+
+static void return_job_token() {
+    while (write(jobserver_fds[1], "+", 1) < 0 && errno == EINTR) {}
+}
+
+// Command prefix that runs a script without network access, through a new
+// network namespace; empty when unprivileged namespaces are not available
+static std::string offline_sandbox() {
+    static std::once_flag once;
+    static std::string prefix;
+    std::call_once(once, []() {
+        std::string unshare = find_in_path("unshare");
+        if (unshare.empty()) return;
+        // -c keeps the caller's uid inside the namespace; older util-linux only maps root
+        for (const char* flags : {" -cn", " -rn"}) {
+            std::string cmd = shell_quote(unshare) + flags;
+            if (std::system((cmd + " true >/dev/null 2>&1").c_str()) == 0) {
+                prefix = cmd + " ";
+                return;
+            }
+        }
+    });
+    return prefix;
+}
+
+// Proxy settings that make curl, wget and git fail instead of reaching the network
+static const char* OFFLINE_ENVIRONMENT =
+    " http_proxy=http://127.0.0.1:9 https_proxy=http://127.0.0.1:9 ftp_proxy=http://127.0.0.1:9"
+    " HTTP_PROXY=http://127.0.0.1:9 HTTPS_PROXY=http://127.0.0.1:9 ALL_PROXY=http://127.0.0.1:9"
+    " no_proxy= NO_PROXY= GIT_ALLOW_PROTOCOL=file";
+
+// Environment contract exported to every install script
+static std::string script_environment(const fs::path& cwd) {
+    fs::path tomlfile = cwd / "cproject.toml";
+    unsigned jobs = default_jobs();
+    if (const char* env = getenv("VC_JOBS"); env && atoi(env) > 0) {
+        jobs = static_cast<unsigned>(atoi(env));
+    }
+
+    std::string cc, cxx;
+    derive_c_cxx(get_compiler_path(tomlfile), cc, cxx);
+    std::string ccache = get_project_flag(tomlfile, "ccache", true) ? find_in_path("ccache") : "";
+    if (!ccache.empty()) {
+        cc = ccache + " " + cc;
+        cxx = ccache + " " + cxx;
+    }
+
+    std::string cflags = get_profile_setting(tomlfile, "cflags", "");
+    std::string cxxflags = get_profile_setting(tomlfile, "cxxflags", cflags);
+    std::string ldflags = get_profile_setting(tomlfile, "ldflags", "");
+    if (split_debug_info(tomlfile)) {
+        // No -gsplit-dwarf: the .dwo files would be deleted with the work directory
+        std::vector<std::string> compile_flags, link_flags;
+        split_compiler_args(split_debug_flags(get_compiler_path(tomlfile), false), compile_flags, link_flags);
+        for (const auto& flag : compile_flags) {
+            cflags += (cflags.empty() ? "" : " ") + flag;
+            cxxflags += (cxxflags.empty() ? "" : " ") + flag;
+        }
+        for (const auto& flag : link_flags) ldflags += (ldflags.empty() ? "" : " ") + flag;
+    }
+
+    std::string env = "VC_JOBS=" + std::to_string(jobs) +
+                      " MAKEFLAGS=" + shell_quote(jobserver_makeflags(jobs));
+    // An explicit -j from cmake --build would make a Makefile build leave the jobserver
+    if (jobserver_fds[0] < 0) env += " CMAKE_BUILD_PARALLEL_LEVEL=" + std::to_string(jobs);
+    env += " VC_PROFILE=" + shell_quote(get_active_profile(tomlfile)) +
+           " CC=" + shell_quote(cc) +
+           " CXX=" + shell_quote(cxx);
+    if (!cflags.empty()) env += " CFLAGS=" + shell_quote(cflags);
+    if (!cxxflags.empty()) env += " CXXFLAGS=" + shell_quote(cxxflags);
+    if (!ldflags.empty()) env += " LDFLAGS=" + shell_quote(ldflags);
+    return env;
+}
+
+// Path of the install script for a library in virtualcdir, resolved through
+// the script index and falling back to the LIB/install_lib.sh convention
+std::string custom_script_path(const std::string& lib_name) {
+    ScriptIndex index(script_index_path());
+    if (auto entry = index.find(lib_name)) {
+        return libs_dir + "/" + entry->script;
+    }
+    return libs_dir + "/" + to_uppercase(lib_name) + "/install_" + to_lowercase(lib_name) + ".sh";
+}
+
+// Function to try installing a library using custom script.
+// If arguments is non-empty it is used instead of prompting; on return it holds the arguments used.
+// A pinned version replaces the version prompt. With kept_work_dir set, the work directory
+// is left for the caller to remove once the package is registered, so a failure to
+// register can be retried without rebuilding.
+bool try_install_custom_library(const std::string& lib_name, const std::string& install_path,
+                                std::vector<std::string>& arguments, const std::string& pinned_version,
+                                fs::path* kept_work_dir) {
+    std::string script_path = custom_script_path(lib_name);
+    std::string morevariable_path = (fs::path(script_path).parent_path() / ".morevariable").string();
 
-// Function to try installing a library using custom script
-bool try_install_custom_library(const std::string& lib_name, const std::string& install_path) {
-    // Convert library name to uppercase for directory search
-    std::string lib_dir_name = to_uppercase(lib_name);
-    std::string script_path = libs_dir + "/" + lib_dir_name + "/install_" + to_lowercase(lib_name) + ".sh";
-    std::string lib_dir = libs_dir + "/" + lib_dir_name;
-    std::string morevariable_path = lib_dir + "/.morevariable";
-    
     // Check if the script exists
     std::ifstream script_file(script_path);
     if (!script_file) {
@@ -15,254 +172,409 @@ bool try_install_custom_library(const std::string& lib_name, const std::string&
         return false;
     }
     script_file.close();
-    
-    // Create a temporary directory for installation
-    std::string temp_dir = "/tmp/vc_install_" + lib_name + "_" + std::to_string(std::time(nullptr));
-    std::string mkdir_cmd = "mkdir -p " + temp_dir;
-    if (execute_command(mkdir_cmd) != 0) {
-        std::cerr << "Error: Failed to create temporary directory for installation" << std::endl;
-        return false;
-    }
-    
-    // Prepare command arguments
-    std::string cmd_args;
-    
-    // Always ask for version number as the first argument
-    std::string version;
-    std::cout << "Enter version number for " << lib_name << ": ";
-    std::getline(std::cin, version);
-
-    if (version.empty()) {
-        cmd_args = "0";
-    } else {
-        cmd_args = version;
-    }
-    
-    // Check if .morevariable file exists
-    std::ifstream morevariable_file(morevariable_path);
-    if (morevariable_file) {
-        std::cout << "Additional parameters needed for " << lib_name << ":" << std::endl;
-        
-        // Read each line as a description and prompt for input
-        std::string description;
-        while (std::getline(morevariable_file, description)) {
-            if (!description.empty()) {
-                std::string variable_value;
-                std::cout << description << ": ";
-                std::getline(std::cin, variable_value);
-                
-                // Add the value to command arguments
-                cmd_args += " \"" + variable_value + "\"";
+
+    if (arguments.empty()) {
+        // Always ask for version number as the first argument, unless it is pinned
+        std::string version = pinned_version;
+        if (version.empty()) {
+            std::cout << "Enter version number for " << lib_name << ": ";
+            std::getline(std::cin, version);
+        }
+        arguments.push_back(version.empty() ? "0" : version);
+
+        // Check if .morevariable file exists
+        std::ifstream morevariable_file(morevariable_path);
+        if (morevariable_file) {
+            std::cout << "Additional parameters needed for " << lib_name << ":" << std::endl;
+
+            // Read each line as a description and prompt for input
+            std::string description;
+            while (std::getline(morevariable_file, description)) {
+                if (!description.empty()) {
+                    std::string variable_value;
+                    std::cout << description << ": ";
+                    std::getline(std::cin, variable_value);
+                    arguments.push_back(variable_value);
+                }
             }
+            morevariable_file.close();
         }
-        morevariable_file.close();
     }
-    
+
+    // Prepare command arguments
+    std::string cmd_args = arguments[0];
+    for (size_t i = 1; i < arguments.size(); ++i) {
+        cmd_args += " \"" + arguments[i] + "\"";
+    }
+
     // Add install prefix to command arguments for installation path
     std::cout << "Installing to: " << install_path << std::endl;
     cmd_args += " \"" + install_path + "\"";
-    
-    // Execute the installation script with all arguments in the temporary directory
-    std::string cmd = "cd " + temp_dir + " && " + script_path + " " + cmd_args;
+
+    // Persistent work directory per package version, configuration and compiler, so a
+    // failed build can resume instead of starting over; downloads are shared across versions
+    fs::path cache_dir = vc_cache_dir();
+    fs::path tomlfile = fs::current_path() / "cproject.toml";
+    std::string compiler_key = compiler_fingerprint(get_compiler_path(tomlfile)).key;
+    if (split_debug_info(tomlfile)) compiler_key += "\ndebug_info split";
+    std::string work_name = to_lowercase(lib_name) + "-" + arguments[0] + "-" +
+                            hash_string(cmd_args + "\n" + compiler_key).substr(0, 8);
+    for (char& c : work_name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-' && c != '_') c = '_';
+    }
+    fs::path work_dir = cache_dir / "work" / work_name;
+    fs::path stage_dir = work_dir / ".vc-stages";
+    if (kept_work_dir) *kept_work_dir = work_dir;
+    fs::path download_dir = cache_dir / "downloads" / to_lowercase(lib_name);
+    fs::create_directories(stage_dir);
+    fs::create_directories(download_dir);
+
+    // Only one vc may drive a given work directory at a time
+    FileLock work_lock(cache_dir / "work" / (work_name + ".lock"));
+
+    // Mirrors: a local download mirror seeds the download cache directly; a
+    // remote one is handed to the script. Offline mode allows neither network
+    MirrorConfig mirror = read_mirror_config();
+    if (mirror.offline && is_network_url(mirror.downloads)) {
+        std::cerr << "Error: Offline mode refuses the network download mirror " << mirror.downloads << std::endl;
+        return false;
+    }
+    std::string download_mirror = mirror.downloads;
+    if (!download_mirror.empty() && !is_network_url(download_mirror)) {
+        fs::path local = download_mirror.rfind("file://", 0) == 0 ? download_mirror.substr(7) : download_mirror;
+        std::error_code ec;
+        fs::copy(local / to_lowercase(lib_name), download_dir, fs::copy_options::recursive | fs::copy_options::skip_existing, ec);
+        download_mirror = "file://" + fs::absolute(local).string();
+    }
+
+    std::string resume_stage;
+    for (const char* stage : INSTALL_STAGES) {
+        if (fs::exists(stage_dir / stage)) resume_stage = stage;
+    }
+    if (resume_stage == "installed" && fs::exists(install_path)) {
+        std::cout << "Reusing completed installation from " << work_dir << std::endl;
+        std::error_code ec;
+        if (!kept_work_dir) fs::remove_all(work_dir, ec);
+        return true;
+    }
+    if (!resume_stage.empty()) {
+        std::cout << "Resuming installation after stage '" << resume_stage << "' in " << work_dir << std::endl;
+    } else {
+        // Without a checkpoint the script starts over, and scripts that do not record
+        // stages expect an empty directory (git clone, mkdir build under set -e)
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(work_dir, ec)) {
+            if (entry.path() != stage_dir) fs::remove_all(entry.path(), ec);
+        }
+    }
+
+    // Offline scripts run without a network namespace where possible. Otherwise
+    // proxies only stop well-behaved tools, so the sources must already be here
+    std::string sandbox = mirror.offline ? offline_sandbox() : "";
+    if (mirror.offline && sandbox.empty()) {
+        std::error_code ec;
+        if (resume_stage.empty() && fs::is_empty(download_dir, ec)) {
+            std::cerr << "Error: Offline mode cannot isolate install scripts from the network here (unshare -n is"
+                      << " unavailable), and " << download_dir << " holds no sources for " << lib_name << std::endl;
+            return false;
+        }
+    }
+
+    // Execute the installation script with all arguments in the work directory
+    std::string env = "VC_WORK_DIR=" + shell_quote(work_dir.string()) +
+                      " VC_STAGE_DIR=" + shell_quote(stage_dir.string()) +
+                      " VC_DOWNLOAD_DIR=" + shell_quote(download_dir.string()) +
+                      " VC_RESUME_STAGE=" + shell_quote(resume_stage) +
+                      " VC_DOWNLOAD_MIRROR=" + shell_quote(download_mirror) +
+                      " VC_OFFLINE=" + (mirror.offline ? "1" : "0") +
+                      (mirror.offline ? OFFLINE_ENVIRONMENT : "") +
+                      " " + script_environment(fs::current_path());
+    std::string cmd = "cd " + shell_quote(work_dir.string()) + " && " + env + " " + sandbox + script_path + " " + cmd_args;
     std::cout << "Executing installation script in " << script_path << std::endl;
-    
-    int result = execute_command(cmd);
-    
-    // Clean up the temporary directory
-    std::string cleanup_cmd = "rm -rf " + temp_dir;
-    execute_command(cleanup_cmd);
-    
+
+    // Script output goes to .venv/.vc/logs/<lib>.log.gz, unless VC_VERBOSE asks for the terminal
+    const char* verbose = getenv("VC_VERBOSE");
+    bool capture = !(verbose && *verbose && std::string(verbose) != "0");
+    fs::path log_base = capture ? vc_state_dir(fs::current_path()) / "logs" / to_lowercase(lib_name) : fs::path();
+
+    InstallUsage usage;
+    usage.package = lib_name;
+    int slot = InstallScheduler::instance().acquire(lib_name);
+    bool token = take_job_token();
+    timespec started;
+    clock_gettime(CLOCK_REALTIME, &started);
+    CapturedOutput output;
+    int result = run_command_with_usage(cmd, usage, log_base, &output);
+    usage.stages = stage_durations(stage_dir, started);
+    if (token) return_job_token();
+    InstallScheduler::instance().release(slot, usage);
+
     if (result != 0) {
         std::cerr << "Installation script failed with exit code " << result << std::endl;
+        if (!output.log.empty()) {
+            std::cerr << "Last " << output.tail.size() << " lines of output (full log: " << output.log.string() << "):" << std::endl;
+            for (const auto& line : output.tail) std::cerr << "  | " << line << std::endl;
+        }
+        std::cerr << "Work directory kept at " << work_dir << "; rerun the install to resume." << std::endl;
         return false;
     }
-    
+    if (!output.log.empty()) {
+        std::cout << "Script output logged to " << output.log.string() << std::endl;
+    }
+
+    // Marked complete; until the work directory is removed, a rerun reuses the installed prefix
+    create_file(stage_dir / "installed");
+    std::error_code ec;
+    if (!kept_work_dir) fs::remove_all(work_dir, ec);
+
     std::cout << "Installation script completed successfully." << std::endl;
     return true;
 }
 
-// Update install_main to handle multiple packages
-int install_main(const std::vector<std::string>& packages) {
-    int result = 0;
-    
-    for (const auto& pkg : packages) {
-        std::cout << "Installing package: " << pkg << std::endl;
-        fs::path cwd = fs::current_path();
-        fs::path tomlfile = cwd / "cproject.toml";
-        fs::path libpath = cwd / ".libpath";
-        fs::path ignorepath = cwd / ".ignorepath";
-        fs::path venv_dir = cwd / ".venv";
-
-        // 1. Check project exists
-        if (!fs::exists(tomlfile)) {
-            std::cout << "Project not initialized. Initializing...\n";
-            create_project(cwd, std::nullopt, std::nullopt);
-        }
-        // 2. Check libpath exists
-        if (!fs::exists(libpath)) {
-            std::ofstream(libpath); // create empty
+// Parse pkg-config output into include paths, lib names and lib paths, skipping ignored paths
+static void parse_pkg_config_flags(const std::string& flags, const std::set<std::string>& ignore, LockEntry& entry) {
+    std::istringstream iss(flags);
+    std::string token;
+    while (iss >> token) {
+        if (token.rfind("-I", 0) == 0) {
+            std::string path = token.substr(2);
+            if (!ignore.count(path)) entry.includes.push_back(path);
+        } else if (token.rfind("-L", 0) == 0) {
+            std::string path = token.substr(2);
+            if (!ignore.count(path)) entry.libpaths.push_back(path);
+        } else if (token.rfind("-l", 0) == 0) {
+            entry.libnames.push_back(token.substr(2));
         }
-        // 3. Check if already installed
-        if (is_package_installed(libpath, pkg)) {
-            std::cout << "Package '" << pkg << "' is already installed.\n";
-            continue;
-        }
-        // 4. Check pkg-config
-        std::string exists_cmd = "pkg-config --exists " + pkg;
-        int pkg_exists = std::system(exists_cmd.c_str());
-        if (pkg_exists == 0) {
-            // Get info
-            std::string cflags = run_cmd("pkg-config --cflags " + pkg);
-            std::string libs = run_cmd("pkg-config --libs " + pkg);
-            std::string version = trim(run_cmd("pkg-config --modversion " + pkg));
-            std::set<std::string> ignore = read_lines_set(ignorepath);
-            std::vector<std::string> includes, libnames, libpaths;
-            // Parse cflags
-            std::istringstream iss(cflags + " " + libs);
-            std::string token;
-            while (iss >> token) {
-                if (token.rfind("-I", 0) == 0) {
-                    std::string path = token.substr(2);
-                    if (!ignore.count(path)) includes.push_back(path);
-                } else if (token.rfind("-L", 0) == 0) {
-                    std::string path = token.substr(2);
-                    if (!ignore.count(path)) libpaths.push_back(path);
-                } else if (token.rfind("-l", 0) == 0) {
-                    libnames.push_back(token.substr(2));
-                }
-            }
-            append_libpath(libpath, pkg, version, includes, libnames, libpaths);
-            add_dependency_toml(tomlfile, pkg, version);
-            std::cout << "Installed '" << pkg << "' from pkg-config.\n";
-            continue;
-        }
-        
-        // 5. Check for install script in virtualcdir
-        // Determine install path from cproject.toml - use absolute paths
-        std::string default_install_path = (venv_dir / pkg).string(); // Default is now absolute
-        std::string install_path = default_install_path; // Start with the default absolute path
-        
-        try {
-            auto tbl = toml::parse_file(tomlfile.string());
-            auto* proj = tbl.get_as<toml::table>("project");
-            if (proj && proj->contains("installpath")) {
-                auto install_node = proj->get("installpath");
-                if (install_node && install_node->is_string()) {
-                    std::string specified_path = install_node->value_or("");
-                    if (!specified_path.empty()) {
-                        // If a path is specified, make it absolute if it's not already
-                        fs::path path_obj(specified_path);
-                        if (path_obj.is_relative()) {
-                            // Append the package name to the path
-                            install_path = (cwd / specified_path / pkg).string();
-                        } else {
-                            // Already absolute, just append the package name
-                            install_path = (path_obj / pkg).string();
-                        }
+    }
+}
+
+// Write a resolved package into .libpath, cproject.toml and cproject.lock
+static void register_package(const fs::path& cwd, const LockEntry& entry) {
+    append_libpath(cwd / ".libpath", entry.name, entry.version, entry.includes, entry.libnames, entry.libpaths);
+    add_dependency_toml(cwd / "cproject.toml", entry.name, entry.version);
+    update_lockfile_entry(cwd / "cproject.lock", entry);
+    if (entry.source == "script") {
+        write_install_manifest(cwd, entry.name, entry.prefix);
+    }
+}
+
+// Determine install path from cproject.toml - use absolute paths
+std::string resolve_install_path(const fs::path& cwd, const std::string& pkg) {
+    fs::path tomlfile = cwd / "cproject.toml";
+    std::string install_path = (cwd / ".venv" / pkg).string(); // Default is absolute
+
+    try {
+        auto tbl = toml::parse_file(tomlfile.string());
+        auto* proj = tbl.get_as<toml::table>("project");
+        if (proj && proj->contains("installpath")) {
+            auto install_node = proj->get("installpath");
+            if (install_node && install_node->is_string()) {
+                std::string specified_path = install_node->value_or("");
+                if (!specified_path.empty()) {
+                    // If a path is specified, make it absolute if it's not already
+                    fs::path path_obj(specified_path);
+                    if (path_obj.is_relative()) {
+                        // Append the package name to the path
+                        install_path = (cwd / specified_path / pkg).string();
+                    } else {
+                        // Already absolute, just append the package name
+                        install_path = (path_obj / pkg).string();
                     }
                 }
             }
-        } catch (const std::exception& ex) {
-            std::cerr << "Warning: Error reading installpath from cproject.toml: " << ex.what() << std::endl;
         }
-        
-        // Create the install directory to ensure parent directories exist
-        fs::create_directories(fs::path(install_path).parent_path());
-        
-        // Try to install with custom script from virtualcdir
-        if (try_install_custom_library(pkg, install_path)) {
-            // After install, first try system pkg-config
-            int pkg_exists2 = std::system(("pkg-config --exists " + pkg).c_str());
-            if (pkg_exists2 == 0) {
-                // Package registered globally, use system pkg-config
-                std::string cflags = run_cmd("pkg-config --cflags " + pkg);
-                std::string libs = run_cmd("pkg-config --libs " + pkg);
-                std::string version2 = trim(run_cmd("pkg-config --modversion " + pkg));
-                std::set<std::string> ignore = read_lines_set(ignorepath);
-                std::vector<std::string> includes, libnames, libpaths;
-                std::istringstream iss(cflags + " " + libs);
-                std::string token;
-                while (iss >> token) {
-                    if (token.rfind("-I", 0) == 0) {
-                        std::string path = token.substr(2);
-                        if (!ignore.count(path)) includes.push_back(path);
-                    } else if (token.rfind("-L", 0) == 0) {
-                        std::string path = token.substr(2);
-                        if (!ignore.count(path)) libpaths.push_back(path);
-                    } else if (token.rfind("-l", 0) == 0) {
-                        libnames.push_back(token.substr(2));
-                    }
-                }
-                append_libpath(libpath, pkg, version2, includes, libnames, libpaths);
-                add_dependency_toml(tomlfile, pkg, version2);
-                std::cout << "Installed '" << pkg << "' using script.\n";
-                continue;
-            } else {
-                // Try to find a local .pc file in the installation path
-                fs::path pc_path = fs::path(install_path) / "lib" / "pkgconfig" / (pkg + ".pc");
-                
-                if (fs::exists(pc_path)) {
-                    std::cout << "Found local pkg-config file: " << pc_path << std::endl;
-                    
-                    // Create custom pkg-config command that uses the specific .pc file
-                    std::string pkg_config_dir = pc_path.parent_path().string();
-                    std::string pkg_config_cmd = "PKG_CONFIG_PATH=\"" + pkg_config_dir + "\" pkg-config";
-                    
-                    // Get package information using the local .pc file
-                    std::string cflags = run_cmd(pkg_config_cmd + " --cflags " + pkg);
-                    std::string libs = run_cmd(pkg_config_cmd + " --libs " + pkg);
-                    std::string version = trim(run_cmd(pkg_config_cmd + " --modversion " + pkg));
-                    
-                    if (version.empty()) version = "0"; // Default if no version found
-                    
-                    std::set<std::string> ignore = read_lines_set(ignorepath);
-                    std::vector<std::string> includes, libnames, libpaths;
-                    
-                    // Parse the pkgconfig output
-                    std::istringstream iss(cflags + " " + libs);
-                    std::string token;
-                    while (iss >> token) {
-                        if (token.rfind("-I", 0) == 0) {
-                            std::string path = token.substr(2);
-                            if (!ignore.count(path)) includes.push_back(path);
-                        } else if (token.rfind("-L", 0) == 0) {
-                            std::string path = token.substr(2);
-                            if (!ignore.count(path)) libpaths.push_back(path);
-                        } else if (token.rfind("-l", 0) == 0) {
-                            libnames.push_back(token.substr(2));
-                        }
-                    }
-                    
-                    // If no includes/libs were found, add standard paths
-                    if (includes.empty() && fs::exists(fs::path(install_path) / "include")) {
-                        includes.push_back((fs::path(install_path) / "include").string());
-                    }
-                    
-                    if (libpaths.empty() && fs::exists(fs::path(install_path) / "lib")) {
-                        libpaths.push_back((fs::path(install_path) / "lib").string());
-                    }
-                    
-                    if (libnames.empty()) {
-                        libnames.push_back(pkg); // Default to package name
-                    }
-                    
-                    append_libpath(libpath, pkg, version, includes, libnames, libpaths);
-                    add_dependency_toml(tomlfile, pkg, version);
-                    std::cout << "Installed '" << pkg << "' using scripts.\n";
-                    continue;
-                } else {
-                    std::cerr << "No pkg-config file found at " << pc_path << std::endl;
-                    std::cerr << "Installation may have failed or package doesn't use pkg-config." << std::endl;
-                    result = 1;
-                    continue;
-                }
+    } catch (const std::exception& ex) {
+        std::cerr << "Warning: Error reading installpath from cproject.toml: " << ex.what() << std::endl;
+    }
+    return install_path;
+}
+
+// Install a single package into the project in the current directory.
+// Script arguments are taken from arguments when non-empty instead of prompting,
+// and the version argument from version when set.
+bool install_package(const std::string& pkg, const std::vector<std::string>& arguments, const std::string& version) {
+    fs::path cwd = fs::current_path();
+    fs::path tomlfile = cwd / "cproject.toml";
+    fs::path libpath = cwd / ".libpath";
+    fs::path ignorepath = cwd / ".ignorepath";
+
+    // 1. Check project exists
+    if (!fs::exists(tomlfile)) {
+        std::cout << "Project not initialized. Initializing...\n";
+        create_project(cwd, std::nullopt, std::nullopt);
+    }
+    // 2. Check libpath exists
+    if (!fs::exists(libpath)) {
+        std::ofstream(libpath, std::ios::app); // create empty without truncating a concurrent writer's file
+    }
+    // 3. Check if already installed
+    if (is_package_installed(libpath, pkg)) {
+        std::cout << "Package '" << pkg << "' is already installed.\n";
+        return true;
+    }
+
+    LockEntry entry;
+    entry.name = pkg;
+
+    // 4. Check pkg-config
+    std::string exists_cmd = "pkg-config --exists " + pkg;
+    int pkg_exists = std::system(exists_cmd.c_str());
+    if (pkg_exists == 0) {
+        // Get info
+        std::string cflags = run_cmd("pkg-config --cflags " + pkg);
+        std::string libs = run_cmd("pkg-config --libs " + pkg);
+        entry.version = trim(run_cmd("pkg-config --modversion " + pkg));
+        entry.source = "pkg-config";
+        parse_pkg_config_flags(cflags + " " + libs, read_lines_set(ignorepath), entry);
+        register_package(cwd, entry);
+        std::cout << "Installed '" << pkg << "' from pkg-config.\n";
+        return true;
+    }
+
+    // 5. Check for install script in virtualcdir
+    std::string install_path = resolve_install_path(cwd, pkg);
+
+    // Create the install directory to ensure parent directories exist
+    fs::create_directories(fs::path(install_path).parent_path());
+
+    // Try to install with custom script from virtualcdir
+    entry.arguments = arguments;
+    fs::path work_dir;
+    if (!try_install_custom_library(pkg, install_path, entry.arguments, version, &work_dir)) {
+        std::cerr << "No install script found and not available via pkg-config." << std::endl;
+        return false;
+    }
+
+    entry.source = "script";
+    entry.script_hash = hash_file(custom_script_path(pkg));
+    entry.prefix = install_path;
+    entry.abi = compiler_fingerprint(get_compiler_path(tomlfile)).abi();
+    if (split_debug_info(tomlfile)) {
+        // Before the prefix is hashed, so vc verify sees the stripped files
+        size_t split = separate_installed_debug_info(install_path);
+        if (split > 0) std::cout << "Moved debug info of " << split << " binaries into .debug files" << std::endl;
+    }
+
+    // After install, first try system pkg-config
+    int pkg_exists2 = std::system(("pkg-config --exists " + pkg).c_str());
+    if (pkg_exists2 == 0) {
+        // Package registered globally, use system pkg-config
+        std::string cflags = run_cmd("pkg-config --cflags " + pkg);
+        std::string libs = run_cmd("pkg-config --libs " + pkg);
+        entry.version = trim(run_cmd("pkg-config --modversion " + pkg));
+        parse_pkg_config_flags(cflags + " " + libs, read_lines_set(ignorepath), entry);
+        entry.prefix_hash = hash_prefix(install_path);
+        register_package(cwd, entry);
+        std::error_code ec;
+        fs::remove_all(work_dir, ec);
+        std::cout << "Installed '" << pkg << "' using script.\n";
+        return true;
+    }
+
+    // Try to find a local .pc file in the installation path
+    fs::path pc_path = fs::path(install_path) / "lib" / "pkgconfig" / (pkg + ".pc");
+    if (!fs::exists(pc_path)) {
+        std::cerr << "No pkg-config file found at " << pc_path << std::endl;
+        std::cerr << "Installation may have failed or package doesn't use pkg-config." << std::endl;
+        return false;
+    }
+
+    std::cout << "Found local pkg-config file: " << pc_path << std::endl;
+
+    // Create custom pkg-config command that uses the specific .pc file
+    std::string pkg_config_dir = pc_path.parent_path().string();
+    std::string pkg_config_cmd = "PKG_CONFIG_PATH=\"" + pkg_config_dir + "\" pkg-config";
+
+    // Get package information using the local .pc file
+    std::string cflags = run_cmd(pkg_config_cmd + " --cflags " + pkg);
+    std::string libs = run_cmd(pkg_config_cmd + " --libs " + pkg);
+    entry.version = trim(run_cmd(pkg_config_cmd + " --modversion " + pkg));
+
+    if (entry.version.empty()) entry.version = "0"; // Default if no version found
+
+    // Parse the pkgconfig output
+    parse_pkg_config_flags(cflags + " " + libs, read_lines_set(ignorepath), entry);
+
+    // If no includes/libs were found, add standard paths
+    if (entry.includes.empty() && fs::exists(fs::path(install_path) / "include")) {
+        entry.includes.push_back((fs::path(install_path) / "include").string());
+    }
+
+    if (entry.libpaths.empty() && fs::exists(fs::path(install_path) / "lib")) {
+        entry.libpaths.push_back((fs::path(install_path) / "lib").string());
+    }
+
+    if (entry.libnames.empty()) {
+        entry.libnames.push_back(pkg); // Default to package name
+    }
+
+    entry.prefix_hash = hash_prefix(install_path);
+    register_package(cwd, entry);
+    std::error_code ec;
+    fs::remove_all(work_dir, ec);
+    std::cout << "Installed '" << pkg << "' using scripts.\n";
+    return true;
+}
+
+// --format=json: each requested package with its outcome and where the time went
+static void write_install_json(const std::vector<std::string>& packages, const std::vector<std::string>& statuses,
+                               const std::vector<double>& seconds, double total_seconds) {
+    fs::path cwd = fs::current_path();
+    std::vector<LockEntry> locked = read_lockfile(cwd / "cproject.lock");
+    std::vector<InstallUsage> usages = InstallScheduler::instance().report();
+
+    std::string json = "{\n  \"command\": \"install\",\n  \"packages\": [";
+    for (size_t i = 0; i < packages.size(); ++i) {
+        LockEntry entry;
+        entry.name = packages[i];
+        for (const auto& lock_entry : locked) {
+            if (lock_entry.name == packages[i]) entry = lock_entry;
+        }
+        std::string durations = "\"total\": " + std::to_string(seconds[i]);
+        long peak_rss_kb = 0;
+        for (const auto& usage : usages) {
+            if (usage.package != packages[i]) continue;
+            durations += ", \"script\": " + std::to_string(usage.wall_seconds) +
+                         ", \"script_cpu\": " + std::to_string(usage.cpu_seconds);
+            for (const auto& [stage, stage_seconds] : usage.stages) {
+                durations += ", \"" + stage + "\": " + std::to_string(stage_seconds);
             }
-        } else {
-            std::cerr << "No install script found and not available via pkg-config." << std::endl;
+            peak_rss_kb = usage.peak_rss_kb;
+        }
+        json += std::string(i ? "," : "") + "\n    " +
+                lock_entry_json(entry, "\"status\": \"" + statuses[i] + "\", \"durations\": {" + durations +
+                                       "}, \"peak_rss_kb\": " + std::to_string(peak_rss_kb));
+    }
+    json += std::string(packages.empty() ? "]" : "\n  ]") + ",\n  \"durations\": {\"total\": " +
+            std::to_string(total_seconds) + "}\n}";
+    write_json_output(json);
+}
+
+// Update install_main to handle multiple packages
+int install_main(const std::vector<std::string>& packages, bool json) {
+    int result = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> statuses;
+    std::vector<double> seconds;
+
+    for (const auto& pkg : packages) {
+        std::cout << "Installing package: " << pkg << std::endl;
+        auto package_start = std::chrono::steady_clock::now();
+        bool already = is_package_installed(fs::current_path() / ".libpath", pkg);
+        if (!install_package(pkg, {})) {
             result = 1;
-            continue;
+            statuses.push_back("failed");
+        } else {
+            statuses.push_back(already ? "already-installed" : "installed");
         }
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - package_start).count());
     }
-    
+
+    print_install_report(InstallScheduler::instance().report());
+    if (json) {
+        write_install_json(packages, statuses, seconds,
+                           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
     return result;
-} 
\ No newline at end of file
+}
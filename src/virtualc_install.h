@@ -3,8 +3,21 @@
 #include "virtualc_common.h"
 #include <vector>
 
-// Install multiple packages
-int install_main(const std::vector<std::string>& packages);
+// Install multiple packages, reporting them as a JSON document on stdout when json is set
+int install_main(const std::vector<std::string>& packages, bool json = false);
 
-// Function to try installing a library using custom script
-bool try_install_custom_library(const std::string& lib_name, const std::string& install_path); 
\ No newline at end of file
+// Install a single package, using the given script arguments instead of prompting when non-empty
+// and version, when set, as the script's version argument instead of asking for one
+bool install_package(const std::string& pkg, const std::vector<std::string>& arguments, const std::string& version = "");
+
+// Function to try installing a library using custom script. With work_dir set, the work
+// directory is kept and returned there for the caller to remove once the package is registered
+bool try_install_custom_library(const std::string& lib_name, const std::string& install_path,
+                                std::vector<std::string>& arguments, const std::string& version = "",
+                                fs::path* work_dir = nullptr);
+
+// Path of the install script for a library in virtualcdir
+std::string custom_script_path(const std::string& lib_name);
+
+// Resolve the install prefix of a package from cproject.toml (installpath) or .venv
+std::string resolve_install_path(const fs::path& cwd, const std::string& pkg);
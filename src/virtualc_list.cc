@@ -1,10 +1,40 @@
 #include "virtualc_list.h"
+#include "virtualc_lock.h"
+#include <chrono>
+
+// --format=json: .libpath entries, completed with source and prefix from cproject.lock
+static int list_packages_json(const fs::path& cwd) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<LockEntry> locked = read_lockfile(cwd / "cproject.lock");
+    std::string packages;
+    for (const auto& libpath_entry : read_libpath_entries(cwd / ".libpath")) {
+        LockEntry entry;
+        for (const auto& lock_entry : locked) {
+            if (lock_entry.name == libpath_entry.name) entry = lock_entry;
+        }
+        entry.name = libpath_entry.name;
+        entry.version = libpath_entry.version;
+        entry.includes = libpath_entry.includes;
+        entry.libnames = libpath_entry.libnames;
+        entry.libpaths = libpath_entry.libpaths;
+        packages += std::string(packages.empty() ? "\n    " : ",\n    ") + lock_entry_json(entry);
+    }
+    std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+    write_json_output("{\n  \"command\": \"list\",\n  \"packages\": [" + packages +
+                      (packages.empty() ? "]" : "\n  ]") + ",\n  \"durations\": {\"total\": " +
+                      std::to_string(total.count()) + "}\n}");
+    return 0;
+}
 
 // Function to list all installed packages
-int list_packages_main() {
+int list_packages_main(bool json) {
     fs::path cwd = fs::current_path();
     fs::path libpath = cwd / ".libpath";
     
+    if (json) {
+        return list_packages_json(cwd);
+    }
+
     // Check if .libpath exists
     if (!fs::exists(libpath)) {
         std::cout << "No packages installed (missing .libpath file).\n";
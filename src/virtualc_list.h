@@ -2,5 +2,5 @@
 
 #include "virtualc_common.h"
 
-// List all installed packages
-int list_packages_main(); 
\ No newline at end of file
+// List all installed packages, as a JSON document on stdout when json is set
+int list_packages_main(bool json = false); 
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "virtualc_lock.h"
+#include "virtualc_modules.h"
+#include <sys/stat.h>
+
+namespace {
+
+// mtime of a directory as "sec.nsec"; empty if it cannot be read
+std::string directory_mtime(const fs::path& dir) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return "";
+    return std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+}
+
+// Where hash_prefix keeps a prefix's hash with the mtimes of its directories
+fs::path prefix_stamp_path(const fs::path& prefix) {
+    return vc_cache_dir() / "prefixes" / (hash_string(prefix.lexically_normal().string()) + ".stamp");
+}
+
+// Hash recorded in stamp_file, if no directory it lists was modified since
+std::string stamped_prefix_hash(const fs::path& stamp_file) {
+    std::ifstream in(stamp_file);
+    std::string hash, line;
+    if (!std::getline(in, hash) || hash.empty()) return "";
+    while (std::getline(in, line)) {
+        size_t space = line.find(' ');
+        if (space == std::string::npos || directory_mtime(line.substr(space + 1)) != line.substr(0, space)) return "";
+    }
+    return hash;
+}
+
+// Utility: convert a string list to a toml array
+toml::array to_toml_array(const std::vector<std::string>& values) {
+    toml::array arr;
+    for (const auto& value : values) arr.push_back(value);
+    return arr;
+}
+
+// Utility: read a string list from a toml table
+std::vector<std::string> from_toml_array(const toml::table& tbl, const std::string& key) {
+    std::vector<std::string> values;
+    if (auto node = tbl.get(key); node && node->is_array()) {
+        for (auto& value : *node->as_array()) {
+            if (auto str = value.value<std::string>()) values.push_back(*str);
+        }
+    }
+    return values;
+}
+
+// Utility: read a string from a toml table
+std::string from_toml_string(const toml::table& tbl, const std::string& key) {
+    if (auto node = tbl.get(key); node && node->is_string()) {
+        return node->value_or("");
+    }
+    return "";
+}
+
+// Rewrite cproject.lock with fn applied to its [package] table
+void modify_lockfile(const fs::path& lockfile, const std::function<void(toml::table&)>& fn) {
+    FileLock lock(project_lock_path(lockfile.parent_path()));
+    toml::table tbl;
+    if (fs::exists(lockfile)) {
+        tbl = toml::parse_file(lockfile.string());
+    }
+    if (!tbl.get_as<toml::table>("package")) {
+        tbl.insert_or_assign("package", toml::table{});
+    }
+    fn(*tbl.get_as<toml::table>("package"));
+
+    std::ostringstream out;
+    out << "# Generated by vc. Records the resolved state of every dependency; do not edit.\n";
+    out << tbl << "\n";
+    write_file_atomic(lockfile, out.str());
+}
+
+} // namespace
+
+// Read every entry of cproject.lock
+std::vector<LockEntry> read_lockfile(const fs::path& lockfile) {
+    std::vector<LockEntry> entries;
+    if (!fs::exists(lockfile)) return entries;
+
+    try {
+        auto tbl = toml::parse_file(lockfile.string());
+        auto* packages = tbl.get_as<toml::table>("package");
+        if (!packages) return entries;
+
+        for (auto&& [key, node] : *packages) {
+            auto* pkg = node.as_table();
+            if (!pkg) continue;
+            LockEntry entry;
+            entry.name = std::string(key.str());
+            entry.version = from_toml_string(*pkg, "version");
+            entry.source = from_toml_string(*pkg, "source");
+            entry.script_hash = from_toml_string(*pkg, "script_hash");
+            entry.prefix = from_toml_string(*pkg, "prefix");
+            entry.prefix_hash = from_toml_string(*pkg, "prefix_hash");
+            entry.abi = from_toml_string(*pkg, "abi");
+            entry.arguments = from_toml_array(*pkg, "arguments");
+            entry.includes = from_toml_array(*pkg, "includes");
+            entry.libnames = from_toml_array(*pkg, "libnames");
+            entry.libpaths = from_toml_array(*pkg, "libpaths");
+            entries.push_back(entry);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error parsing cproject.lock: " << ex.what() << std::endl;
+    }
+    return entries;
+}
+
+// Insert or replace one entry of cproject.lock
+void update_lockfile_entry(const fs::path& lockfile, const LockEntry& entry) {
+    modify_lockfile(lockfile, [&](toml::table& packages) {
+        toml::table pkg;
+        pkg.insert_or_assign("version", entry.version);
+        pkg.insert_or_assign("source", entry.source);
+        if (!entry.script_hash.empty()) pkg.insert_or_assign("script_hash", entry.script_hash);
+        if (!entry.prefix.empty()) pkg.insert_or_assign("prefix", entry.prefix);
+        if (!entry.prefix_hash.empty()) pkg.insert_or_assign("prefix_hash", entry.prefix_hash);
+        if (!entry.abi.empty()) pkg.insert_or_assign("abi", entry.abi);
+        if (!entry.arguments.empty()) pkg.insert_or_assign("arguments", to_toml_array(entry.arguments));
+        pkg.insert_or_assign("includes", to_toml_array(entry.includes));
+        pkg.insert_or_assign("libnames", to_toml_array(entry.libnames));
+        pkg.insert_or_assign("libpaths", to_toml_array(entry.libpaths));
+        packages.insert_or_assign(entry.name, std::move(pkg));
+    });
+}
+
+// Remove one entry from cproject.lock
+void remove_lockfile_entry(const fs::path& lockfile, const std::string& pkg) {
+    if (!fs::exists(lockfile)) return;
+    modify_lockfile(lockfile, [&](toml::table& packages) {
+        packages.erase(pkg);
+    });
+}
+
+// Hash of the relative paths and sizes of every file under an install prefix.
+// Adding, removing or replacing a file changes its directory's mtime, so while
+// no directory changed the hash recorded by the last walk is returned as is
+std::string hash_prefix(const fs::path& prefix) {
+    fs::path stamp_file = prefix_stamp_path(prefix);
+    if (std::string hash = stamped_prefix_hash(stamp_file); !hash.empty()) return hash;
+
+    // Each directory is stamped before its entries are listed, so a file added
+    // during the walk leaves a stamp that no longer matches
+    std::string stamps = directory_mtime(prefix) + " " + prefix.string() + "\n";
+    std::vector<std::string> listing;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(prefix, fs::directory_options::skip_permission_denied, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (it->is_directory(ec)) {
+            if (it->path().filename() == BMI_DIR_NAME) {
+                it.disable_recursion_pending();
+            } else if (!it->is_symlink(ec)) {
+                stamps += directory_mtime(it->path()) + " " + it->path().string() + "\n";
+            }
+            continue;
+        }
+        if (!it->is_regular_file(ec)) continue;
+        listing.push_back(it->path().lexically_relative(prefix).string() + " " + std::to_string(it->file_size(ec)));
+    }
+    if (listing.empty()) return "";
+    std::sort(listing.begin(), listing.end());
+
+    std::string data;
+    for (const auto& line : listing) data += line + "\n";
+    std::string hash = hash_string(data);
+    // The stamp only saves the next walk; failing to write it is not an error
+    try {
+        fs::create_directories(stamp_file.parent_path());
+        write_file_atomic(stamp_file, hash + "\n" + stamps);
+    } catch (const std::exception&) {
+    }
+    return hash;
+}
+
+// JSON object for one package: name, version, source, prefix and the compiler
+// flags it contributes, followed by extra_fields when given
+std::string lock_entry_json(const LockEntry& entry, const std::string& extra_fields) {
+    std::vector<std::string> flags;
+    for (const auto& include : entry.includes) flags.push_back("-I" + include);
+    for (const auto& path : entry.libpaths) flags.push_back("-L" + path);
+    for (const auto& name : entry.libnames) flags.push_back("-l" + name);
+    return "{\"name\": \"" + json_escape(entry.name) + "\", \"version\": \"" + json_escape(entry.version) +
+           "\", \"source\": \"" + json_escape(entry.source) + "\", \"prefix\": \"" + json_escape(entry.prefix) +
+           "\", \"flags\": " + json_string_array(flags) + (extra_fields.empty() ? "" : ", " + extra_fields) + "}";
+}
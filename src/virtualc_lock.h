@@ -0,0 +1,36 @@
+#pragma once
+
+#include "virtualc_common.h"
+#include "virtualc_hash.h"
+
+// Resolved state of one dependency as recorded in cproject.lock
+struct LockEntry {
+    std::string name;
+    std::string version;
+    std::string source;          // "pkg-config" or "script"
+    std::string script_hash;     // hash of the install script, script installs only
+    std::string prefix;          // install prefix, script installs only
+    std::string prefix_hash;     // hash of the file listing under prefix
+    std::string abi;             // target and compiler release that built it, script installs only
+    std::vector<std::string> arguments; // script arguments (version and .morevariable answers)
+    std::vector<std::string> includes;
+    std::vector<std::string> libnames;
+    std::vector<std::string> libpaths;
+};
+
+// Read every entry of cproject.lock
+std::vector<LockEntry> read_lockfile(const fs::path& lockfile);
+
+// Insert or replace one entry of cproject.lock
+void update_lockfile_entry(const fs::path& lockfile, const LockEntry& entry);
+
+// Remove one entry from cproject.lock
+void remove_lockfile_entry(const fs::path& lockfile, const std::string& pkg);
+
+// JSON object for one package: name, version, source, prefix and the compiler
+// flags it contributes, followed by extra_fields when given
+std::string lock_entry_json(const LockEntry& entry, const std::string& extra_fields = "");
+
+// Hash of the relative paths and sizes of every file under an install prefix;
+// reused without a walk while none of the prefix's directories changed
+std::string hash_prefix(const fs::path& prefix);
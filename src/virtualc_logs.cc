@@ -0,0 +1,290 @@
+#include "virtualc_logs.h"
+#include <thread>
+#include <csignal>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Lines of output kept for the failure report
+const size_t TAIL_LINES = 20;
+// A script's background children may hold its pipe open; stop waiting for them after this
+const auto EXIT_GRACE = std::chrono::seconds(2);
+// Redraw interval of the status line, and heartbeat interval when stderr is not a terminal
+const auto DRAW_INTERVAL = std::chrono::milliseconds(100);
+const auto HEARTBEAT_INTERVAL = std::chrono::seconds(60);
+
+// Epoll keys: capture id and which end of it is ready
+const uint64_t INPUT_SIDE = 0;
+const uint64_t OUTPUT_SIDE = 1;
+
+void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+std::string format_elapsed(Clock::duration elapsed) {
+    long seconds = static_cast<long>(std::chrono::duration_cast<std::chrono::seconds>(elapsed).count());
+    return seconds >= 60 ? std::to_string(seconds / 60) + "m" + std::to_string(seconds % 60) + "s"
+                         : std::to_string(seconds) + "s";
+}
+
+unsigned terminal_width() {
+    struct winsize ws;
+    if (ioctl(STDERR_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+    return 80;
+}
+
+} // namespace
+
+struct InstallLogs::Stream {
+    std::string package;
+    fs::path log;
+    int in_fd = -1;          // script output, non-blocking
+    int out_fd = -1;         // gzip's stdin or the plain log file, non-blocking
+    pid_t gzip_pid = -1;
+    bool want_output = false;
+    std::string pending;     // read but not yet accepted by out_fd
+    std::string partial;     // current unterminated line
+    std::string last_line;
+    std::deque<std::string> tail;
+    Clock::time_point started;
+    Clock::time_point exited_at;
+    bool exited = false;     // the script process is gone
+    bool eof = false;        // and so is every process holding its pipe
+    bool closed = false;     // input drained and log closed
+};
+
+InstallLogs& InstallLogs::instance() {
+    // Never destroyed: the epoll thread outlives main
+    static InstallLogs* logs = new InstallLogs();
+    return *logs;
+}
+
+InstallLogs::InstallLogs() {
+    gzip_ = find_in_path("gzip");
+    tty_ = isatty(STDERR_FILENO);
+    last_draw_ = Clock::now();
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    std::thread(&InstallLogs::run, this).detach();
+}
+
+// Start draining fd, the read end of a script's stdout/stderr pipe, into
+// log_base.log.gz (.log without gzip); returns the capture id
+int InstallLogs::attach(const std::string& package, int fd, const fs::path& log_base) {
+    auto stream = std::make_unique<Stream>();
+    stream->package = package;
+    stream->in_fd = fd;
+    stream->started = Clock::now();
+    stream->log = log_base.string() + (gzip_.empty() ? ".log" : ".log.gz");
+    std::error_code ec;
+    fs::create_directories(stream->log.parent_path(), ec);
+
+    int log_fd = open(stream->log.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int gzip_pipe[2];
+    if (log_fd >= 0 && !gzip_.empty() && pipe2(gzip_pipe, O_CLOEXEC) == 0) {
+        // gzip compresses in its own process; vc only ever hands it buffered bytes
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, gzip_pipe[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, log_fd, STDOUT_FILENO);
+        char* argv[] = {const_cast<char*>(gzip_.c_str()), const_cast<char*>("-c"), nullptr};
+        if (posix_spawn(&stream->gzip_pid, gzip_.c_str(), &actions, nullptr, argv, environ) == 0) {
+            stream->out_fd = gzip_pipe[1];
+        } else {
+            stream->gzip_pid = -1;
+            close(gzip_pipe[1]);
+        }
+        posix_spawn_file_actions_destroy(&actions);
+        close(gzip_pipe[0]);
+        close(log_fd);
+    } else {
+        stream->out_fd = log_fd;
+    }
+    set_nonblocking(fd);
+    if (stream->out_fd >= 0) set_nonblocking(stream->out_fd);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = next_id_++;
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = static_cast<uint64_t>(id) << 1 | INPUT_SIDE;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    streams_[id] = std::move(stream);
+    return id;
+}
+
+// Once the script has exited: wait for its output to be drained, close the
+// log and return it with the tail of the output
+CapturedOutput InstallLogs::detach(int id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = streams_.find(id);
+    if (it == streams_.end()) return {};
+    Stream& stream = *it->second;
+    stream.exited = true;
+    stream.exited_at = Clock::now();
+    cv_.wait(lock, [&]() { return stream.closed; });
+
+    if (!stream.partial.empty()) stream.tail.push_back(stream.partial);
+    CapturedOutput captured{stream.log, std::vector<std::string>(stream.tail.begin(), stream.tail.end())};
+    pid_t gzip_pid = stream.gzip_pid;
+    streams_.erase(it);
+    // The caller reports next; start it on a clean line
+    clear_status();
+    lock.unlock();
+
+    if (gzip_pid > 0) {
+        while (waitpid(gzip_pid, nullptr, 0) < 0 && errno == EINTR) {}
+    }
+    return captured;
+}
+
+// Read what the script printed so far, keeping the tail and the latest line
+void InstallLogs::drain(Stream& stream) {
+    char buffer[65536];
+    // Bounded per wakeup so one chatty script cannot starve the others
+    for (int round = 0; round < 16; ++round) {
+        ssize_t n = read(stream.in_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return;  // EAGAIN: drained for now
+        if (n == 0) {
+            stream.eof = true;
+            return;
+        }
+        if (stream.out_fd >= 0) stream.pending.append(buffer, static_cast<size_t>(n));
+        for (ssize_t i = 0; i < n; ++i) {
+            char c = buffer[i];
+            if (c == '\n' || c == '\r') {
+                // \r-terminated progress updates replace the line instead of adding to the tail
+                if (!stream.partial.empty()) stream.last_line = stream.partial;
+                if (c == '\n') {
+                    stream.tail.push_back(stream.partial);
+                    if (stream.tail.size() > TAIL_LINES) stream.tail.pop_front();
+                }
+                stream.partial.clear();
+            } else if (stream.partial.size() < 4096) {
+                stream.partial += c;
+            }
+        }
+    }
+}
+
+// Hand pending output to the log without blocking; wait for EPOLLOUT on a full pipe
+void InstallLogs::flush(int id, Stream& stream) {
+    size_t written = 0;
+    while (written < stream.pending.size()) {
+        ssize_t n = write(stream.out_fd, stream.pending.data() + written, stream.pending.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EAGAIN) {
+            // The log is lost (gzip died, disk full); keep draining the script regardless
+            written = stream.pending.size();
+            break;
+        }
+        if (n < 0) break;
+        written += static_cast<size_t>(n);
+    }
+    stream.pending.erase(0, written);
+
+    bool want_output = !stream.pending.empty();
+    if (want_output != stream.want_output) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLOUT;
+        ev.data.u64 = static_cast<uint64_t>(id) << 1 | OUTPUT_SIDE;
+        epoll_ctl(epoll_fd_, want_output ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, stream.out_fd, &ev);
+        stream.want_output = want_output;
+    }
+}
+
+// Stop reading a script whose output ended, and close its log once written out
+void InstallLogs::finish_input(Stream& stream) {
+    if (stream.in_fd >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, stream.in_fd, nullptr);
+        close(stream.in_fd);
+        stream.in_fd = -1;
+    }
+    if (!stream.pending.empty()) return;
+    if (stream.out_fd >= 0) {
+        if (stream.want_output) epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, stream.out_fd, nullptr);
+        close(stream.out_fd);
+        stream.out_fd = -1;
+    }
+    stream.closed = true;
+    cv_.notify_all();
+}
+
+void InstallLogs::run() {
+    // A dead gzip must fail the write with EPIPE rather than kill vc; blocking
+    // SIGPIPE in this thread alone leaves the disposition children inherit alone
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+
+    struct epoll_event events[32];
+    while (true) {
+        int n = epoll_wait(epoll_fd_, events, 32, static_cast<int>(DRAW_INTERVAL.count()));
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < n; ++i) {
+            int id = static_cast<int>(events[i].data.u64 >> 1);
+            auto it = streams_.find(id);
+            if (it == streams_.end() || it->second->closed) continue;
+            Stream& stream = *it->second;
+            if ((events[i].data.u64 & 1) == INPUT_SIDE) {
+                if (stream.in_fd < 0) continue;
+                drain(stream);
+                last_active_ = id;
+            }
+            if (stream.out_fd >= 0) flush(id, stream);
+        }
+
+        auto now = Clock::now();
+        for (auto& [id, stream] : streams_) {
+            if (stream->closed) continue;
+            if (stream->eof || (stream->exited && now - stream->exited_at >= EXIT_GRACE)) finish_input(*stream);
+        }
+        draw_status(now);
+    }
+}
+
+// One status line while scripts run: who is running for how long, and the latest output
+void InstallLogs::draw_status(Clock::time_point now) {
+    if (streams_.empty()) return;
+    if (now - last_draw_ < (tty_ ? DRAW_INTERVAL : HEARTBEAT_INTERVAL)) return;
+    last_draw_ = now;
+
+    std::string line = tty_ ? "" : "Still running: ";
+    bool first = true;
+    for (const auto& [id, stream] : streams_) {
+        if (stream->closed) continue;
+        line += (first ? "" : ", ") + stream->package + " " + format_elapsed(now - stream->started);
+        first = false;
+    }
+    if (!tty_) {
+        std::cerr << line << std::endl;
+        return;
+    }
+    auto active = streams_.find(last_active_);
+    if (active != streams_.end() && !active->second->last_line.empty()) {
+        line += " | " + active->second->package + ": " + active->second->last_line;
+    }
+    // Control characters from the script would break the redraw
+    for (char& c : line) {
+        if (static_cast<unsigned char>(c) < 0x20) c = ' ';
+    }
+    unsigned width = terminal_width();
+    if (line.size() >= width) line.resize(width - 1);
+    std::cerr << "\r\033[K" << line << std::flush;
+    status_shown_ = true;
+}
+
+void InstallLogs::clear_status() {
+    if (!status_shown_) return;
+    std::cerr << "\r\033[K" << std::flush;
+    status_shown_ = false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "virtualc_common.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// What a captured script left behind: its log file and the last lines it printed
+struct CapturedOutput {
+    fs::path log;
+    std::vector<std::string> tail;
+};
+
+// Captures the output of running install scripts. One epoll thread drains every
+// script's pipe into a gzip-compressed log per package and a live status line,
+// so neither the terminal nor the disk can hold a build up
+class InstallLogs {
+public:
+    static InstallLogs& instance();
+
+    // Start draining fd, the read end of a script's stdout/stderr pipe, into
+    // log_base.log.gz (.log without gzip); returns the capture id
+    int attach(const std::string& package, int fd, const fs::path& log_base);
+
+    // Once the script has exited: wait for its output to be drained, close the
+    // log and return it with the tail of the output
+    CapturedOutput detach(int id);
+
+private:
+    struct Stream;
+
+    InstallLogs();
+    void run();
+    void drain(Stream& stream);
+    void flush(int id, Stream& stream);
+    void finish_input(Stream& stream);
+    void draw_status(std::chrono::steady_clock::time_point now);
+    void clear_status();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int epoll_fd_ = -1;
+    int next_id_ = 0;
+    std::map<int, std::unique_ptr<Stream>> streams_;
+    std::string gzip_;
+    bool tty_ = false;
+    bool status_shown_ = false;
+    int last_active_ = -1;
+    std::chrono::steady_clock::time_point last_draw_;
+};
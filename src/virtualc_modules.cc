@@ -0,0 +1,229 @@
+#include "virtualc_modules.h"
+#include "virtualc_compiler.h"
+#include <map>
+#include <sys/stat.h>
+
+// Directory inside a package prefix that holds its prebuilt header units
+const char* BMI_DIR_NAME = ".bmi";
+
+namespace {
+
+const std::set<std::string> HEADER_EXTENSIONS = {".h", ".hh", ".hpp", ".hxx", ".h++"};
+// -std values that support header units
+const std::set<std::string> MODULE_STANDARDS = {"c++20", "c++2a", "c++23", "c++2b", "c++26", "c++2c",
+                                                "gnu++20", "gnu++2a", "gnu++23", "gnu++2b", "gnu++26", "gnu++2c"};
+
+struct HeaderUnit {
+    fs::path header;
+    fs::path gcm;
+    fs::path bmi_dir;
+    bool built = false;
+};
+
+// Identity of each input as device, inode, size and mtime, one line per path
+std::string input_record(const std::vector<fs::path>& inputs) {
+    std::string record;
+    for (const auto& input : inputs) {
+        struct stat st;
+        if (stat(input.c_str(), &st) != 0) {
+            record += "0 0 0 0 " + input.string() + "\n";
+            continue;
+        }
+        record += std::to_string(st.st_dev) + " " + std::to_string(st.st_ino) + " " + std::to_string(st.st_size) + " " +
+                  std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec) + " " +
+                  input.string() + "\n";
+    }
+    return record;
+}
+
+// Whether any input listed in record_file was replaced or changed since it was written
+bool inputs_changed(const fs::path& record_file) {
+    std::string record = read_file(record_file);
+    if (record.empty()) return true;
+    std::vector<fs::path> inputs;
+    std::istringstream in(record);
+    std::string line;
+    while (std::getline(in, line)) {
+        // The path follows the four numeric fields and may itself contain spaces
+        size_t pos = 0;
+        int fields = 0;
+        while (fields < 4 && (pos = line.find(' ', pos)) != std::string::npos) {
+            ++fields;
+            ++pos;
+        }
+        if (fields < 4) return true;
+        inputs.push_back(line.substr(pos));
+    }
+    return input_record(inputs) != record;
+}
+
+bool is_newer(const fs::path& a, const fs::path& b) {
+    struct stat sa, sb;
+    if (stat(a.c_str(), &sa) != 0) return false;
+    if (stat(b.c_str(), &sb) != 0) return true;
+    return sa.st_mtim.tv_sec > sb.st_mtim.tv_sec ||
+           (sa.st_mtim.tv_sec == sb.st_mtim.tv_sec && sa.st_mtim.tv_nsec > sb.st_mtim.tv_nsec);
+}
+
+// Headers of every .venv package include directory, with the BMI path each maps to
+std::vector<HeaderUnit> collect_header_units(const fs::path& root, const std::string& key) {
+    std::vector<HeaderUnit> units;
+    std::error_code ec;
+    fs::path venv = fs::weakly_canonical(root / ".venv", ec);
+    std::set<fs::path> seen;
+    for (const auto& entry : read_libpath_entries(root / ".libpath")) {
+        for (const auto& include : entry.includes) {
+            fs::path dir = fs::weakly_canonical(include, ec);
+            fs::path rel = dir.lexically_relative(venv);
+            if (rel.empty() || *rel.begin() == ".." || *rel.begin() == ".vc" || !seen.insert(dir).second) continue;
+
+            // Header units live alongside the package: .venv/<pkg>/.bmi/<key>
+            fs::path package_dir = venv / *rel.begin();
+            fs::path bmi_dir = package_dir / BMI_DIR_NAME / key;
+            // Walk the directory as .libpath spells it: GCC names a header unit by the path it found
+            for (auto it = fs::recursive_directory_iterator(include, fs::directory_options::skip_permission_denied, ec);
+                 it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                if (ec) break;
+                if (it->is_directory(ec) && it->path().filename() == BMI_DIR_NAME) {
+                    it.disable_recursion_pending();
+                    continue;
+                }
+                if (!it->is_regular_file(ec) || !HEADER_EXTENSIONS.count(it->path().extension().string())) continue;
+                fs::path in_package = (dir / it->path().lexically_relative(include)).lexically_relative(package_dir);
+                units.push_back({it->path(), bmi_dir / (in_package.string() + ".gcm"), bmi_dir});
+            }
+        }
+    }
+    return units;
+}
+
+} // namespace
+
+// Prebuild GCC header units for the public headers of .venv packages and
+// return the flags that make a C++ compile import them; empty if unavailable
+std::vector<std::string> prepare_header_units(const fs::path& root, const std::string& compiler,
+                                              const std::vector<std::string>& compile_flags) {
+    // GCC 11 or newer can build header units
+    const CompilerFingerprint& fingerprint = compiler_fingerprint(compiler);
+    if (fingerprint.family != "gcc" || atoi(fingerprint.major.c_str()) < 11 || !fingerprint.supports("-fmodules-ts")) {
+        std::cerr << "header units: " << compiler << " is not GCC 11 or newer; compiling headers textually" << std::endl;
+        return {};
+    }
+
+    std::vector<std::string> flags = compile_flags;
+    bool has_std = false;
+    for (const auto& flag : compile_flags) {
+        if (flag.rfind("-std=", 0) != 0) continue;
+        has_std = true;
+        if (!MODULE_STANDARDS.count(flag.substr(5))) {
+            std::cerr << "header units: " << flag << " predates C++20; compiling headers textually" << std::endl;
+            return {};
+        }
+    }
+    if (!has_std) flags.push_back("-std=c++20");
+    flags.push_back("-fmodules-ts");
+
+    // BMIs are only valid for the exact compiler and flags that produced them
+    std::string key_data = fingerprint.key + "\n" + compiler;
+    for (const auto& flag : flags) key_data += "\n" + flag;
+    std::string key = hash_string(key_data);
+
+    fs::path state_dir = vc_state_dir(root) / "header-units";
+    fs::create_directories(state_dir);
+    FileLock lock(state_dir / "lock");
+
+    std::vector<HeaderUnit> units = collect_header_units(root, key);
+    if (units.empty()) return {};
+
+    // Headers that cannot stand alone are remembered until they change
+    std::map<fs::path, std::set<std::string>> failed;
+    for (const auto& unit : units) {
+        if (!failed.count(unit.bmi_dir)) failed[unit.bmi_dir] = read_lines_set(unit.bmi_dir / "failed");
+    }
+
+    std::vector<size_t> stale;
+    for (size_t i = 0; i < units.size(); ++i) {
+        auto& unit = units[i];
+        if (failed[unit.bmi_dir].count(unit.header.string()) && !is_newer(unit.header, unit.bmi_dir / "failed")) continue;
+        // Rebuilt when the header or anything it includes differs from the recorded
+        // inputs, so a file replaced by an older copy still invalidates the unit
+        std::error_code ec;
+        if (!fs::exists(unit.gcm, ec) || inputs_changed(unit.gcm.string() + ".inputs")) {
+            stale.push_back(i);
+        } else {
+            unit.built = true;
+        }
+    }
+
+    if (!stale.empty()) {
+        std::cout << "Prebuilding " << stale.size() << " header units..." << std::endl;
+        std::string base_cmd = compiler;
+        for (const auto& flag : flags) base_cmd += " " + shell_quote(flag);
+        parallel_for(stale.size(), [&](size_t i) {
+            auto& unit = units[stale[i]];
+            std::error_code ec;
+            fs::create_directories(unit.gcm.parent_path(), ec);
+            // Each header is built against a mapper naming only itself, so the
+            // BMIs do not depend on each other and can be built in any order
+            fs::path mapper = fs::path(unit.gcm.string() + ".map");
+            fs::path depfile = fs::path(unit.gcm.string() + ".d");
+            fs::path record = fs::path(unit.gcm.string() + ".inputs");
+            create_file(mapper, unit.header.string() + " " + unit.gcm.string() + "\n");
+            std::string cmd = base_cmd + " -fmodule-mapper=" + shell_quote(mapper.string()) +
+                              " -fmodule-header -x c++-header " + shell_quote(unit.header.string()) +
+                              " -MMD -MF " + shell_quote(depfile.string()) + " >/dev/null 2>&1";
+            unit.built = std::system(cmd.c_str()) == 0 && fs::exists(unit.gcm, ec);
+            std::vector<fs::path> inputs = read_depfile(depfile);
+            if (inputs.empty()) inputs.push_back(unit.header);
+            if (unit.built) {
+                create_file(record, input_record(inputs));
+            } else {
+                fs::remove(record, ec);
+            }
+            fs::remove(depfile, ec);
+        });
+
+        size_t failures = 0;
+        std::set<fs::path> changed;
+        for (size_t i : stale) {
+            auto& list = failed[units[i].bmi_dir];
+            if (units[i].built) {
+                list.erase(units[i].header.string());
+            } else {
+                list.insert(units[i].header.string());
+                failures++;
+            }
+            changed.insert(units[i].bmi_dir);
+        }
+        for (const auto& bmi_dir : changed) {
+            std::string content;
+            for (const auto& header : failed[bmi_dir]) content += header + "\n";
+            create_file(bmi_dir / "failed", content);
+        }
+        if (failures) {
+            std::cout << failures << " headers are not self-contained and stay textual includes." << std::endl;
+        }
+    }
+
+    // One mapper per package, plus the combined one a compile is pointed at
+    std::map<fs::path, std::string> package_maps;
+    std::string combined;
+    for (const auto& unit : units) {
+        if (!unit.built) continue;
+        std::string line = unit.header.string() + " " + unit.gcm.string() + "\n";
+        package_maps[unit.bmi_dir] += line;
+        combined += line;
+    }
+    if (combined.empty()) return {};
+    for (const auto& [bmi_dir, content] : package_maps) {
+        if (read_file(bmi_dir / "mapper") != content) write_file_atomic(bmi_dir / "mapper", content);
+    }
+    fs::path mapper = state_dir / (key + ".map");
+    if (read_file(mapper) != combined) write_file_atomic(mapper, combined);
+
+    std::vector<std::string> unit_flags;
+    if (!has_std) unit_flags.push_back("-std=c++20");
+    unit_flags.push_back("-fmodules-ts");
+    unit_flags.push_back("-fmodule-mapper=" + mapper.string());
+    return unit_flags;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Directory inside a package prefix that holds its prebuilt header units
+extern const char* BMI_DIR_NAME;
+
+// Prebuild GCC header units for the public headers of .venv packages and
+// return the flags that make a C++ compile import them; empty if unavailable
+std::vector<std::string> prepare_header_units(const fs::path& root, const std::string& compiler,
+                                              const std::vector<std::string>& compile_flags);
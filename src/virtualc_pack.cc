@@ -0,0 +1,167 @@
+#include "virtualc_pack.h"
+#include "virtualc_lock.h"
+#include "virtualc_verify.h"
+#include <map>
+
+namespace {
+
+// State under .venv/.vc that is tied to this machine and must not travel in an archive
+const std::vector<std::string> PACK_EXCLUDES = {
+    ".venv/.vc/lock", ".venv/.vc/hashcache", ".venv/.vc/env.cache", ".venv/.vc/run", ".venv/.vc/*.tmp.*",
+    ".venv/.vc/header-units", ".venv/*/.bmi"
+};
+
+bool has_zstd() {
+    return execute_command("command -v zstd >/dev/null 2>&1") == 0;
+}
+
+// Replace every occurrence of from with to in a file; returns true if it changed
+bool rebase_file(const fs::path& path, const std::string& from, const std::string& to) {
+    std::string content = read_file(path);
+    std::string rebased;
+    size_t pos = 0;
+    bool changed = false;
+    while (true) {
+        size_t found = content.find(from, pos);
+        if (found == std::string::npos) break;
+        rebased.append(content, pos, found - pos);
+        rebased += to;
+        pos = found + from.size();
+        changed = true;
+    }
+    if (!changed) return false;
+    rebased.append(content, pos, std::string::npos);
+    write_file_atomic(path, rebased);
+    return true;
+}
+
+} // namespace
+
+// Implement pack subcommand
+int pack_main(int argc, char** argv) {
+    cxxopts::Options options("vc pack", "Archive .venv and .libpath for fast restore");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("o,output", "Archive to write", cxxopts::value<std::string>()->default_value("venv.tar.zst"));
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    fs::path cwd = fs::current_path();
+    if (!fs::exists(cwd / ".libpath") || !fs::is_directory(cwd / ".venv")) {
+        std::cerr << "Error: Nothing to pack (.libpath or .venv not found)." << std::endl;
+        return 1;
+    }
+    if (!has_zstd()) {
+        std::cerr << "Error: zstd is required for vc pack." << std::endl;
+        return 1;
+    }
+
+    for (const auto& entry : read_lockfile(cwd / "cproject.lock")) {
+        fs::path rel = fs::path(entry.prefix).lexically_relative(cwd);
+        if (!entry.prefix.empty() && (rel.empty() || *rel.begin() == "..")) {
+            std::cerr << "Warning: '" << entry.name << "' is installed outside the project (" << entry.prefix
+                      << ") and is not included." << std::endl;
+        }
+    }
+
+    // Record where the tree lives so unpack can rebase absolute paths in one pass
+    create_file(vc_state_dir(cwd) / "pack.root", fs::canonical(cwd).string() + "\n");
+
+    fs::path archive = fs::absolute(result["output"].as<std::string>());
+    std::string cmd = "tar --use-compress-program='zstd -T0 -q' -C " + shell_quote(cwd.string());
+    for (const auto& exclude : PACK_EXCLUDES) {
+        cmd += " --exclude=" + shell_quote(exclude);
+    }
+    cmd += " -cf " + shell_quote(archive.string()) + " .libpath .venv";
+    if (fs::exists(cwd / "cproject.lock")) cmd += " cproject.lock";
+
+    std::cout << "Packing .venv into " << archive << std::endl;
+    if (execute_command(cmd) != 0) {
+        std::cerr << "Error: Failed to create archive." << std::endl;
+        return 1;
+    }
+    std::cout << "Packed " << fs::file_size(archive) << " bytes." << std::endl;
+    return 0;
+}
+
+// Implement unpack subcommand
+int unpack_main(int argc, char** argv) {
+    cxxopts::Options options("vc unpack", "Restore an archive created by vc pack");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("f,force", "Replace an existing .venv")
+        ("archive", "Archive to restore", cxxopts::value<std::string>()->default_value("venv.tar.zst"));
+    options.parse_positional({"archive"});
+    options.positional_help("[ARCHIVE]");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    fs::path cwd = fs::current_path();
+    fs::path archive = fs::absolute(result["archive"].as<std::string>());
+    if (!fs::exists(archive)) {
+        std::cerr << "Error: Archive " << archive << " not found." << std::endl;
+        return 1;
+    }
+    if (!has_zstd()) {
+        std::cerr << "Error: zstd is required for vc unpack." << std::endl;
+        return 1;
+    }
+    if (fs::exists(cwd / ".venv")) {
+        if (!result.count("force")) {
+            std::cerr << "Error: .venv already exists. Use --force to replace it." << std::endl;
+            return 1;
+        }
+        fs::remove_all(cwd / ".venv");
+    }
+
+    // 1. Restore in a single sequential read
+    std::string cmd = "tar --use-compress-program='zstd -d -q' -C " + shell_quote(cwd.string()) +
+                      " -xf " + shell_quote(archive.string());
+    std::cout << "Unpacking " << archive << std::endl;
+    if (execute_command(cmd) != 0) {
+        std::cerr << "Error: Failed to extract archive." << std::endl;
+        return 1;
+    }
+
+    // 2. Rebase absolute paths from the packing machine onto this project
+    fs::path root_file = vc_state_dir(cwd) / "pack.root";
+    std::string old_root = trim(read_file(root_file));
+    std::string new_root = fs::canonical(cwd).string();
+    if (old_root.empty() || old_root == new_root) {
+        std::cout << "Unpacked; no paths needed rebasing." << std::endl;
+        return 0;
+    }
+
+    size_t rebased = 0;
+    if (rebase_file(cwd / ".libpath", old_root, new_root)) rebased++;
+    if (fs::exists(cwd / "cproject.lock") && rebase_file(cwd / "cproject.lock", old_root, new_root)) rebased++;
+
+    std::map<std::string, std::vector<std::string>> rewritten;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(cwd / ".venv", ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (!it->is_regular_file(ec) || it->path().extension() != ".pc") continue;
+        if (!rebase_file(it->path(), old_root, new_root)) continue;
+        rebased++;
+
+        // Keep install manifests in step so vc verify does not flag the rewrite as drift
+        fs::path rel = it->path().lexically_relative(cwd / ".venv");
+        std::string pkg = rel.begin()->string();
+        rewritten[pkg].push_back(rel.lexically_relative(pkg).string());
+    }
+    for (const auto& [pkg, files] : rewritten) {
+        refresh_install_manifest(cwd, pkg, cwd / ".venv" / pkg, files);
+    }
+
+    create_file(root_file, new_root + "\n");
+    std::cout << "Unpacked and rebased " << rebased << " file(s) from " << old_root << " to " << new_root << "." << std::endl;
+    return 0;
+}
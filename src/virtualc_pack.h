@@ -0,0 +1,9 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Archive .venv and .libpath into a relocatable zstd-compressed tarball
+int pack_main(int argc, char** argv);
+
+// Restore an archive created by pack_main and rebase it onto this project
+int unpack_main(int argc, char** argv);
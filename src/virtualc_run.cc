@@ -1,11 +1,469 @@
 #include "virtualc_run.h"
 #include "virtualc_install.h"
+#include "virtualc_unity.h"
+#include "virtualc_modules.h"
+#include "virtualc_worker.h"
+#include "virtualc_compiler.h"
+#include "virtualc_debuginfo.h"
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Hash of the declared dependencies and the .libpath state they resolve to
+static std::string dependency_state_hash(const fs::path& tomlfile, const fs::path& libpath) {
+    std::string state;
+    for (const auto& spec : get_dependency_specs(tomlfile)) {
+        state += "dep " + spec + "\n";
+    }
+    for (const auto& entry : read_libpath_entries(libpath)) {
+        state += "[" + entry.name + "] " + entry.version + "\n";
+        for (const auto& include : entry.includes) state += "I" + include + "\n";
+        for (const auto& path : entry.libpaths) state += "L" + path + "\n";
+        for (const auto& lib : entry.libnames) state += "l" + lib + "\n";
+    }
+    return hash_string(state);
+}
+
+// Check that a dependency is registered in .libpath and its directories still exist
+static bool is_dependency_resolved(const std::vector<LibpathEntry>& entries, const std::string& dep) {
+    for (const auto& entry : entries) {
+        if (entry.name != dep) continue;
+        std::error_code ec;
+        for (const auto& include : entry.includes) {
+            if (!fs::is_directory(include, ec)) return false;
+        }
+        for (const auto& path : entry.libpaths) {
+            if (!fs::is_directory(path, ec)) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Initialize the project at root if needed and install dependencies that
+// changed since the state recorded in .verified
+static int resolve_dependencies(const fs::path& root) {
+    fs::path tomlfile = root / "cproject.toml";
+    fs::path libpath = root / ".libpath";
+    fs::path verified = root / ".verified";
+
+    // Initialize project if it doesn't exist
+    if (!fs::exists(tomlfile)) {
+        std::cout << "Project not initialized. Initializing..." << std::endl;
+        create_project(root, std::nullopt, std::nullopt);
+    }
+    
+    // Check .verified against the current dependency state
+    std::string state_hash = dependency_state_hash(tomlfile, libpath);
+    std::string verified_hash;
+    {
+        std::ifstream verified_in(verified);
+        std::getline(verified_in, verified_hash);
+    }
+    if (verified_hash != state_hash) {
+        std::cout << "Verifying dependencies..." << std::endl;
+        
+        // Get dependencies from cproject.toml
+        std::vector<std::string> dependencies = get_dependencies(tomlfile);
+        std::vector<LibpathEntry> entries = read_libpath_entries(libpath);
+        
+        // Check every dependency in parallel; installs stay serial since scripts prompt
+        std::vector<char> resolved(dependencies.size(), 0);
+        parallel_for(dependencies.size(), [&](size_t i) {
+            resolved[i] = is_dependency_resolved(entries, dependencies[i]);
+        });
+
+        bool all_deps_installed = true;
+        for (size_t i = 0; i < dependencies.size(); ++i) {
+            if (resolved[i]) continue;
+            const std::string& dep = dependencies[i];
+            if (check_package_installed(libpath, dep)) {
+                // Registered but its directories are gone; drop the stale entry and reinstall
+                remove_package_from_libpath(libpath, dep);
+            }
+            std::cout << "Dependency '" << dep << "' not installed. Installing..." << std::endl;
+            // Install the missing dependency
+            std::vector<std::string> dep_to_install = {dep};
+            if (install_main(dep_to_install) != 0) {
+                std::cerr << "Failed to install dependency '" << dep << "'." << std::endl;
+                all_deps_installed = false;
+            }
+        }
+        
+        if (all_deps_installed) {
+            // Record the state that was verified
+            write_file_atomic(verified, dependency_state_hash(tomlfile, libpath) + "\n");
+        } else {
+            std::cerr << "Not all dependencies could be installed." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Profile cflags and debug flags, .libpath flags, profile ldflags and rpath for an output directory
+static std::vector<std::string> project_compiler_args(const fs::path& root, const fs::path& output_dir) {
+    fs::path tomlfile = root / "cproject.toml";
+    fs::path libpath = root / ".libpath";
+    std::vector<std::string> compiler_args = split_flags(get_profile_setting(tomlfile, "cflags", ""));
+    if (split_debug_info(tomlfile)) {
+        std::vector<std::string> debug_flags = split_debug_flags(get_compiler_path(tomlfile));
+        compiler_args.insert(compiler_args.end(), debug_flags.begin(), debug_flags.end());
+    }
+    std::vector<std::string> libpath_args = build_compiler_args(libpath);
+    compiler_args.insert(compiler_args.end(), libpath_args.begin(), libpath_args.end());
+    std::vector<std::string> ldflags = split_flags(get_profile_setting(tomlfile, "ldflags", ""));
+    compiler_args.insert(compiler_args.end(), ldflags.begin(), ldflags.end());
+    std::vector<std::string> rpath_args = build_rpath_args(libpath, tomlfile, output_dir);
+    compiler_args.insert(compiler_args.end(), rpath_args.begin(), rpath_args.end());
+    return compiler_args;
+}
+
+// Other sources next to source whose default output, <stem>.out, is the same file
+static std::vector<fs::path> sources_sharing_output(const fs::path& source) {
+    std::vector<fs::path> others;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(source.parent_path(), ec)) {
+        const fs::path& path = entry.path();
+        if (path.filename() != source.filename() && path.stem() == source.stem() &&
+            entry.is_regular_file(ec) && is_source_file(path)) {
+            others.push_back(path);
+        }
+    }
+    std::sort(others.begin(), others.end());
+    return others;
+}
+
+// Replace this process with the built program, forwarding the remaining arguments
+static int exec_program(const fs::path& output, const std::vector<std::string>& program_args, const fs::path& cwd) {
+    std::vector<char*> exec_argv;
+    std::string program = output.string();
+    exec_argv.push_back(const_cast<char*>(program.c_str()));
+    for (const auto& arg : program_args) {
+        exec_argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    exec_argv.push_back(nullptr);
+
+    // Run from the directory vc was invoked in, not the project directory
+    fs::current_path(cwd);
+    std::cout.flush();
+    std::cerr.flush();
+    execv(program.c_str(), exec_argv.data());
+
+    std::cerr << "Error: Failed to execute '" << program << "': " << strerror(errno) << std::endl;
+    return 127;
+}
+
+// One entry point of vc run --each
+struct EachResult {
+    fs::path source;
+    fs::path output;
+    fs::path log;
+    bool compiled = false;
+    bool up_to_date = false;
+    int exit_code = -1;  // program exit status, -1 when it did not run
+    double compile_seconds = 0;
+    double run_seconds = 0;
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --format=json fields of one entry point: what was built with which flags, and how long each phase took
+static std::string entry_json(const EachResult& result, const std::string& compiler,
+                              const std::vector<std::string>& flags, const std::string& indent) {
+    std::string build = !result.compiled ? "failed" : result.up_to_date ? "up-to-date" : "compiled";
+    std::string json = indent + "\"source\": \"" + json_escape(result.source.string()) + "\",\n" +
+                       indent + "\"output\": \"" + json_escape(result.output.string()) + "\",\n" +
+                       indent + "\"compiler\": \"" + json_escape(compiler) + "\",\n" +
+                       indent + "\"flags\": " + json_string_array(flags) + ",\n" +
+                       indent + "\"build\": \"" + build + "\",\n" +
+                       indent + "\"exit_code\": " + (result.exit_code >= 0 ? std::to_string(result.exit_code) : "null") + ",\n";
+    if (!result.log.empty()) json += indent + "\"log\": \"" + json_escape(result.log.string()) + "\",\n";
+    return json + indent + "\"durations\": {\"compile\": " + std::to_string(result.compile_seconds) +
+           ", \"run\": " + std::to_string(result.run_seconds);
+}
+
+// --format=json document for a single vc run
+static std::string run_json(const EachResult& result, const std::string& compiler, const std::vector<std::string>& flags,
+                            double resolve_seconds, double total_seconds) {
+    return "{\n  \"command\": \"run\",\n" + entry_json(result, compiler, flags, "  ") +
+           ", \"resolve\": " + std::to_string(resolve_seconds) + ", \"total\": " + std::to_string(total_seconds) + "}\n}";
+}
+
+// Run a built program with stdin from /dev/null and output appended to log (or with
+// vc's own stdio when log is empty); returns its exit status, 128 + signal when
+// killed, or 127 when it could not be started
+static int run_logged(const fs::path& program, const std::vector<std::string>& program_args,
+                      const fs::path& cwd, const fs::path& log, unsigned timeout) {
+    // Prepared before fork: vc runs several of these from worker threads
+    std::string program_str = program.string();
+    std::vector<char*> exec_argv = {const_cast<char*>(program_str.c_str())};
+    for (const auto& arg : program_args) exec_argv.push_back(const_cast<char*>(arg.c_str()));
+    exec_argv.push_back(nullptr);
+    int log_fd = log.empty() ? -1 : open(log.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    int null_fd = log.empty() ? -1 : open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(cwd.c_str()) != 0) _exit(127);
+        if (null_fd >= 0) dup2(null_fd, STDIN_FILENO);
+        if (log_fd >= 0) {
+            dup2(log_fd, STDOUT_FILENO);
+            dup2(log_fd, STDERR_FILENO);
+        }
+        // The alarm survives exec, so a hanging program is killed by SIGALRM
+        if (timeout > 0) alarm(timeout);
+        execv(exec_argv[0], exec_argv.data());
+        _exit(127);
+    }
+    if (log_fd >= 0) close(log_fd);
+    if (null_fd >= 0) close(null_fd);
+    if (pid < 0) return 127;
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
+}
+
+// Entry points named by a directory (its source files) or a glob pattern
+static std::vector<fs::path> expand_entry_points(const std::string& pattern) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    if (fs::is_directory(pattern, ec)) {
+        for (const auto& entry : fs::directory_iterator(pattern, ec)) {
+            if (entry.is_regular_file(ec) && is_source_file(entry.path())) files.push_back(fs::absolute(entry.path()));
+        }
+    } else {
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                fs::path path = matches.gl_pathv[i];
+                if (is_source_file(path)) files.push_back(fs::absolute(path));
+            }
+        }
+        globfree(&matches);
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Implement vc run --each: build, and unless --no-exec run, every entry point in parallel
+static int run_each(int argc, char** argv) {
+    if (argc < 1) {
+        std::cerr << "Error: --each needs a directory or glob pattern" << std::endl;
+        return 1;
+    }
+    fs::path invocation_dir = fs::current_path();
+    std::string pattern = argv[0];
+
+    bool no_exec = false;
+    unsigned jobs = default_jobs();
+    unsigned timeout = 0;
+    std::vector<std::string> user_args;
+    std::vector<std::string> program_args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i] ? argv[i] : "";
+        if (arg == "--") {
+            program_args.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--no-exec") {
+            no_exec = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            timeout = static_cast<unsigned>(std::max(0, atoi(argv[++i])));
+        } else if (!arg.empty()) {
+            user_args.push_back(arg);
+        }
+    }
+
+    std::vector<fs::path> files = expand_entry_points(pattern);
+    if (files.empty()) {
+        std::cerr << "Error: No source files match '" << pattern << "'" << std::endl;
+        return 1;
+    }
+
+    // Like vc run, the project is the directory holding the entry points
+    fs::path root = files.front().parent_path();
+    for (const auto& file : files) {
+        if (file.parent_path() != root) {
+            std::cerr << "Error: --each entry points must share one directory (" << root << " and "
+                      << file.parent_path() << ")" << std::endl;
+            return 1;
+        }
+    }
+    // Workers must never share an output: both would link it and write its depfile and cmdfile
+    std::map<std::string, fs::path> outputs;
+    for (const auto& file : files) {
+        auto [it, inserted] = outputs.emplace(file.stem().string(), file);
+        if (!inserted) {
+            std::cerr << "Error: " << it->second.filename().string() << " and " << file.filename().string()
+                      << " would both build " << file.stem().string() << ".out; narrow the pattern." << std::endl;
+            return 1;
+        }
+    }
+    fs::current_path(root);
+
+    // Project state is resolved once for the whole batch
+    auto batch_start = std::chrono::steady_clock::now();
+    if (int result = resolve_dependencies(root); result != 0) {
+        return result;
+    }
+    double resolve_seconds = seconds_since(batch_start);
+    fs::path tomlfile = root / "cproject.toml";
+    fs::path libpath = root / ".libpath";
+    std::string compiler = get_compiler_path(tomlfile);
+    std::vector<std::string> compiler_args = project_compiler_args(root, root);
+    bool split_debug = split_debug_info(tomlfile);
+
+    bool all_cxx = std::none_of(files.begin(), files.end(), [](const fs::path& p) { return p.extension() == ".c"; });
+    if (all_cxx && get_project_flag(tomlfile, "header_units", false)) {
+        std::vector<std::string> compile_flags, link_flags;
+        split_compiler_args(compiler_args, compile_flags, link_flags);
+        compile_flags.insert(compile_flags.end(), user_args.begin(), user_args.end());
+        std::vector<std::string> unit_flags = prepare_header_units(root, compiler, compile_flags);
+        compiler_args.insert(compiler_args.end(), unit_flags.begin(), unit_flags.end());
+    }
+
+    std::string shared_args;
+    for (const auto& arg : compiler_args) shared_args += " " + shell_quote(arg);
+    for (const auto& arg : user_args) shared_args += " " + shell_quote(arg);
+
+    fs::path state_dir = vc_state_dir(root) / "run";
+    fs::path log_dir = vc_state_dir(root) / "each";
+    fs::create_directories(state_dir);
+    fs::create_directories(log_dir);
+
+    std::cout << (no_exec ? "Building " : "Building and running ") << files.size() << " entry points with "
+              << jobs << " jobs..." << std::endl;
+
+    std::vector<EachResult> results(files.size());
+    std::mutex output_mutex;
+    parallel_for(files.size(), [&](size_t i) {
+        using Clock = std::chrono::steady_clock;
+        EachResult& result = results[i];
+        result.source = files[i];
+        result.output = root / (files[i].stem().string() + ".out");
+        result.log = log_dir / (files[i].stem().string() + ".log");
+
+        // Same command and state files as a single vc run, so both share up-to-date checks
+        std::string output_key = hash_string(result.output.string());
+        fs::path depfile = state_dir / (output_key + ".d");
+        fs::path cmdfile = state_dir / (output_key + ".cmd");
+        std::string cmd = compiler + " " + shell_quote(files[i].string()) + shared_args +
+                          " -o " + shell_quote(result.output.string());
+        std::string recorded_cmd = fingerprinted_command(compiler, cmd);
+
+        auto start = Clock::now();
+        if (is_up_to_date(result.output, {files[i], tomlfile, libpath}, depfile, cmdfile, recorded_cmd)) {
+            result.compiled = result.up_to_date = true;
+            create_file(result.log, "");
+        } else {
+            // A cmdfile that cannot be removed would vouch for a failed build, so
+            // the entry fails instead; throwing would abandon the rest of the batch
+            std::error_code ec;
+            fs::remove(cmdfile, ec);
+            create_file(result.log, "$ " + cmd + "\n" + (ec ? "Error: " + ec.message() + "\n" : ""));
+            std::string logged = cmd + " -MMD -MF " + shell_quote(depfile.string()) +
+                                 " >>" + shell_quote(result.log.string()) + " 2>&1";
+            result.compiled = !ec && std::system(logged.c_str()) == 0;
+            if (result.compiled) create_file(cmdfile, recorded_cmd + "\n");
+        }
+        if (result.compiled && split_debug) separate_debug_info(result.output, linked_dwo_files(result.output));
+        result.compile_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (result.compiled && !no_exec) {
+            start = Clock::now();
+            result.exit_code = run_logged(result.output, program_args, invocation_dir, result.log, timeout);
+            result.run_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        bool passed = result.compiled && (no_exec || result.exit_code == 0);
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << (passed ? "  PASS " : "  FAIL ") << files[i].filename().string() << std::endl;
+    }, jobs);
+
+    // Consolidated report, in file order
+    size_t failed = 0;
+    std::cout << "\nResults:" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& result : results) {
+        std::string name = result.source.filename().string();
+        if (!result.compiled) {
+            std::cout << "  FAIL  " << name << ": compile error, see " << result.log.string() << std::endl;
+            failed++;
+        } else if (!no_exec && result.exit_code != 0) {
+            std::cout << "  FAIL  " << name << ": exit " << result.exit_code << " after " << result.run_seconds
+                      << "s, see " << result.log.string() << std::endl;
+            failed++;
+        } else {
+            std::cout << "  PASS  " << name << ": ";
+            if (result.up_to_date) {
+                std::cout << "up to date";
+            } else {
+                std::cout << "built in " << result.compile_seconds << "s";
+            }
+            if (!no_exec) std::cout << ", ran in " << result.run_seconds << "s";
+            std::cout << std::endl;
+        }
+    }
+    std::cout << (results.size() - failed) << " passed, " << failed << " failed" << std::endl;
+
+    if (json_output_enabled()) {
+        std::vector<std::string> flags = compiler_args;
+        flags.insert(flags.end(), user_args.begin(), user_args.end());
+        std::string json = "{\n  \"command\": \"run\",\n  \"entries\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            json += std::string(i ? "," : "") + "\n    {\n" + entry_json(results[i], compiler, flags, "      ") + "}\n    }";
+        }
+        json += "\n  ],\n  \"durations\": {\"resolve\": " + std::to_string(resolve_seconds) +
+                ", \"total\": " + std::to_string(seconds_since(batch_start)) + "}\n}";
+        write_json_output(json);
+    }
+    return failed == 0 ? 0 : 1;
+}
 
 // Implement run subcommand
 int run_main(int argc, char** argv) {
-    // Get absolute path to file
+    if (std::string(argv[0]) == "--each") {
+        return run_each(argc - 1, argv + 1);
+    }
+
+    // Get absolute path to file, remembering where vc was invoked from
+    fs::path invocation_dir = fs::current_path();
     fs::path file_path = fs::absolute(argv[0]);
-    
+
+    // Split vc options, compiler arguments and program arguments (after "--")
+    bool no_exec = false;
+    bool unity = false;
+    std::optional<fs::path> output_override;
+    std::vector<std::string> user_args;
+    std::vector<std::string> program_args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i] ? argv[i] : "";
+        if (arg == "--") {
+            program_args.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--no-exec") {
+            no_exec = true;
+        } else if (arg == "--unity") {
+            unity = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            output_override = fs::absolute(argv[++i]);
+        } else if (!arg.empty()) {
+            user_args.push_back(arg);
+        }
+    }
+
     // 1. Extract parent directory and ensure it exists
     fs::path parent_dir = file_path.parent_path();
     if (!fs::exists(parent_dir)) {
@@ -19,89 +477,139 @@ int run_main(int argc, char** argv) {
     // Set up paths
     fs::path tomlfile = parent_dir / "cproject.toml";
     fs::path libpath = parent_dir / ".libpath";
-    fs::path verified = parent_dir / ".verified";
     
-    // 3. Initialize project if it doesn't exist
-    if (!fs::exists(tomlfile)) {
-        std::cout << "Project not initialized. Initializing..." << std::endl;
-        create_project(parent_dir, std::nullopt, std::nullopt);
+    // 3-4. Initialize the project and make sure its dependencies are installed
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    bool json = json_output_enabled();
+    EachResult report;
+    report.source = file_path;
+    if (int result = resolve_dependencies(parent_dir); result != 0) {
+        if (json) write_json_output(run_json(report, "", {}, seconds_since(start), seconds_since(start)));
+        return result;
     }
+    double resolve_seconds = seconds_since(start);
+    auto compile_start = Clock::now();
     
-    // 4. Check .verified and dependencies
-    if (!fs::exists(verified)) {
-        std::cout << "Verifying dependencies..." << std::endl;
-        
-        // Get dependencies from cproject.toml
-        std::vector<std::string> dependencies = get_dependencies(tomlfile);
-        
-        // Check each dependency is installed
-        bool all_deps_installed = true;
-        for (const auto& dep : dependencies) {
-            if (!check_package_installed(libpath, dep)) {
-                std::cout << "Dependency '" << dep << "' not installed. Installing..." << std::endl;
-                // Install the missing dependency
-                std::vector<std::string> dep_to_install = {dep};
-                if (install_main(dep_to_install) != 0) {
-                    std::cerr << "Failed to install dependency '" << dep << "'." << std::endl;
-                    all_deps_installed = false;
-                }
-            }
-        }
-        
-        if (all_deps_installed) {
-            // Create .verified file
-            std::ofstream verified_file(verified);
-            verified_file.close();
-        } else {
-            std::cerr << "Not all dependencies could be installed." << std::endl;
+    // 5. Compile the file with compiler and arguments into a per-source output
+    if (!output_override) {
+        // foo.c and foo.cpp would keep overwriting one foo.out and its up-to-date state
+        std::vector<fs::path> clashes = sources_sharing_output(file_path);
+        if (!clashes.empty()) {
+            std::cerr << "Error: " << file_path.filename().string() << " and " << clashes.front().filename().string()
+                      << " both build " << file_path.stem().string() << ".out; choose an output with -o." << std::endl;
+            if (json) write_json_output(run_json(report, "", {}, resolve_seconds, seconds_since(start)));
             return 1;
         }
     }
-    
-    // 5. Run the file with compiler and arguments
+    fs::path output = output_override ? *output_override : parent_dir / (file_path.stem().string() + ".out");
+    report.output = output;
+    fs::path state_dir = vc_state_dir(parent_dir) / "run";
+    fs::create_directories(state_dir);
+    std::string output_key = hash_string(output.string());
+    fs::path depfile = state_dir / (output_key + ".d");
+    fs::path cmdfile = state_dir / (output_key + ".cmd");
+
     std::string compiler = get_compiler_path(tomlfile);
-    std::vector<std::string> compiler_args = build_compiler_args(libpath);
+    std::vector<std::string> compiler_args = project_compiler_args(parent_dir, output.parent_path());
     
+    std::vector<fs::path> sources = {file_path};
+    std::vector<std::string> extra_flags;
+    for (const auto& arg : user_args) {
+        if (is_source_file(arg)) {
+            sources.push_back(fs::absolute(parent_dir / arg));
+        } else {
+            extra_flags.push_back(arg);
+        }
+    }
+
+    // Header units: C++ builds import prebuilt BMIs of .venv package headers
+    bool all_cxx = std::none_of(sources.begin(), sources.end(), [](const fs::path& p) { return p.extension() == ".c"; });
+    if (all_cxx && get_project_flag(tomlfile, "header_units", false)) {
+        std::vector<std::string> compile_flags, link_flags;
+        split_compiler_args(compiler_args, compile_flags, link_flags);
+        compile_flags.insert(compile_flags.end(), extra_flags.begin(), extra_flags.end());
+        std::vector<std::string> unit_flags = prepare_header_units(parent_dir, compiler, compile_flags);
+        compiler_args.insert(compiler_args.end(), unit_flags.begin(), unit_flags.end());
+    }
+
+    // Unity mode batches several sources into jumbo files compiled in parallel;
+    // with workers configured, every object build is fanned out to them. Several
+    // sources are always built as objects: one compile writes a single depfile,
+    // holding only the last unit's headers
+    std::vector<std::string> flags = compiler_args;
+    flags.insert(flags.end(), extra_flags.begin(), extra_flags.end());
+    bool group_sources = (unity || get_project_flag(tomlfile, "unity", false)) && sources.size() > 1;
+    std::vector<std::string> workers = configured_workers(tomlfile);
+    bool per_object = group_sources || !workers.empty() || sources.size() > 1;
+
+    // Replace vc with the built program, or in JSON mode run it as a child so
+    // its exit status and time can be reported
+    auto finish = [&]() -> int {
+        if (report.compiled && split_debug_info(tomlfile)) {
+            separate_debug_info(output, per_object ? unity_dwo_files(output, parent_dir) : linked_dwo_files(output));
+        }
+        report.compile_seconds = seconds_since(compile_start);
+        if (report.compiled && !no_exec && !json) {
+            return exec_program(output, program_args, invocation_dir);
+        }
+        if (report.compiled && !no_exec) {
+            auto run_start = Clock::now();
+            report.exit_code = run_logged(output, program_args, invocation_dir, "", 0);
+            report.run_seconds = seconds_since(run_start);
+        }
+        if (json) write_json_output(run_json(report, compiler, flags, resolve_seconds, seconds_since(start)));
+        if (!report.compiled) return 1;
+        if (no_exec || report.exit_code == 0) return 0;
+        return report.exit_code > 0 ? report.exit_code : 1;
+    };
+
+    if (per_object) {
+        report.compiled = unity_build(compiler, sources, flags, output, parent_dir, group_sources, workers) == 0;
+        return finish();
+    }
+
     // Construct command
     std::string cmd = compiler;
     
     // Add the input file
-    cmd += " \"" + file_path.string() + "\"";
+    cmd += " " + shell_quote(file_path.string());
     
     // Add the compiler arguments from .libpath
     for (const auto& arg : compiler_args) {
-        if (arg.find(' ') != std::string::npos) {
-            cmd += " \"" + arg + "\"";
-        } else {
-            cmd += " " + arg;
-        }
+        cmd += " " + shell_quote(arg);
     }
     
     // Add any additional arguments passed to the command
-    for (int i = 1; i < argc; i++) {
-        if (argv[i] && strlen(argv[i]) > 0) {
-            if (strchr(argv[i], ' ') != nullptr) {
-                cmd += " \"" + std::string(argv[i]) + "\"";
-            } else {
-                cmd += " " + std::string(argv[i]);
-            }
-        }
+    for (const auto& arg : user_args) {
+        cmd += " " + shell_quote(arg);
     }
     
-    // Add standard output binary name
-    cmd += " -o a.out";
-    
-    // Show command
-    std::cout << "Executing: " << cmd << std::endl;
-    
-    // Execute the command
-    int result = std::system(cmd.c_str());
-    
-    if (result == 0) {
-        std::cout << "Compilation successful." << std::endl;
+    // Add the per-source output binary name
+    cmd += " -o " + shell_quote(output.string());
+
+    // A single translation unit here, so the one depfile covers every header it reads
+    std::vector<fs::path> inputs = {file_path, tomlfile, libpath};
+    // Recorded with the compiler's fingerprint, so an upgraded compiler rebuilds
+    std::string recorded_cmd = fingerprinted_command(compiler, cmd);
+    if (is_up_to_date(output, inputs, depfile, cmdfile, recorded_cmd)) {
+        std::cout << output.filename().string() << " is up to date." << std::endl;
+        report.up_to_date = true;
     } else {
-        std::cerr << "Compilation failed." << std::endl;
+        // Show command
+        std::cout << "Executing: " << cmd << std::endl;
+
+        // Execute the command, recording header dependencies for the next up-to-date check
+        fs::remove(cmdfile);
+        int result = std::system((cmd + " -MMD -MF " + shell_quote(depfile.string())).c_str());
+
+        if (result != 0) {
+            std::cerr << "Compilation failed." << std::endl;
+            return finish();
+        }
+        std::cout << "Compilation successful." << std::endl;
+        create_file(cmdfile, recorded_cmd + "\n");
     }
-    
-    return result;
-} 
\ No newline at end of file
+    report.compiled = true;
+    return finish();
+}
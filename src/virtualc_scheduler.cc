@@ -0,0 +1,265 @@
+#include "virtualc_scheduler.h"
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Memory assumed for a package that has never been built here
+const long DEFAULT_INSTALL_KB = 1024L * 1024L;
+
+// Memory kept free for the rest of the system
+const long RESERVE_KB = 512L * 1024L;
+
+// MemAvailable from /proc/meminfo, or -1 if unknown
+long available_memory_kb() {
+    std::ifstream in("/proc/meminfo");
+    std::string key;
+    long value;
+    std::string unit;
+    while (in >> key >> value >> unit) {
+        if (key == "MemAvailable:") return value;
+    }
+    return -1;
+}
+
+fs::path history_path() {
+    return vc_cache_dir() / "install_stats";
+}
+
+double timeval_seconds(const struct timeval& tv) {
+    return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+}
+
+// How often the memory of a running install is sampled
+const auto RSS_SAMPLE_INTERVAL = std::chrono::milliseconds(200);
+
+// Resident memory of root and every live descendant, summed from /proc. Processes
+// that daemonize are reparented away and no longer counted
+long process_tree_rss_kb(pid_t root) {
+    static const long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    std::map<pid_t, std::vector<pid_t>> children;
+    std::map<pid_t, long> rss_pages;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator("/proc", ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.empty() || !std::all_of(name.begin(), name.end(), ::isdigit)) continue;
+        std::ifstream in(entry.path() / "stat");
+        std::string stat;
+        if (!std::getline(in, stat)) continue;
+        // comm may contain spaces and parentheses; the fields resume after the last ')'
+        size_t paren = stat.rfind(')');
+        if (paren == std::string::npos) continue;
+        std::istringstream fields(stat.substr(paren + 1));
+        std::string field;
+        pid_t ppid = 0;
+        long rss = 0;
+        for (int i = 3; i <= 24 && fields >> field; ++i) {
+            if (i == 4) ppid = static_cast<pid_t>(atol(field.c_str()));
+            if (i == 24) rss = atol(field.c_str());
+        }
+        pid_t pid = static_cast<pid_t>(atol(name.c_str()));
+        children[ppid].push_back(pid);
+        rss_pages[pid] = rss;
+    }
+
+    long total = 0;
+    std::vector<pid_t> pending = {root};
+    while (!pending.empty()) {
+        pid_t pid = pending.back();
+        pending.pop_back();
+        total += rss_pages[pid];
+        auto it = children.find(pid);
+        if (it != children.end()) pending.insert(pending.end(), it->second.begin(), it->second.end());
+    }
+    return total * page_kb;
+}
+
+} // namespace
+
+// Run a shell command and collect its resource usage: CPU time from wait4, and peak
+// memory as the largest sum of resident memory over the command and its descendants.
+// With log_base set, its stdout and stderr are captured into a compressed log there
+// instead of reaching the terminal, and output receives the log and last lines
+int run_command_with_usage(const std::string& command, InstallUsage& usage,
+                           const fs::path& log_base, CapturedOutput* output) {
+    auto start = std::chrono::steady_clock::now();
+    std::cout.flush();
+    int pipe_fds[2] = {-1, -1};
+    if (!log_base.empty() && pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        pipe_fds[0] = pipe_fds[1] = -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        if (pipe_fds[0] >= 0) {
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+        }
+        return -1;
+    }
+    if (pid == 0) {
+        if (pipe_fds[1] >= 0) {
+            dup2(pipe_fds[1], STDOUT_FILENO);
+            dup2(pipe_fds[1], STDERR_FILENO);
+        }
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    int capture = -1;
+    if (pipe_fds[0] >= 0) {
+        close(pipe_fds[1]);
+        capture = InstallLogs::instance().attach(usage.package, pipe_fds[0], log_base);
+    }
+
+    // ru_maxrss is only the largest single process; make -j peaks are the sum of
+    // its compilers, so the tree is sampled while the command runs
+    long peak_kb = 0;
+    bool finished = false;
+    std::mutex sample_mutex;
+    std::condition_variable sample_cv;
+    std::thread sampler([&]() {
+        std::unique_lock<std::mutex> lock(sample_mutex);
+        while (!finished) {
+            lock.unlock();
+            long rss = process_tree_rss_kb(pid);
+            lock.lock();
+            peak_kb = std::max(peak_kb, rss);
+            sample_cv.wait_for(lock, RSS_SAMPLE_INTERVAL, [&]() { return finished; });
+        }
+    });
+
+    int status = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    while (wait4(pid, &status, 0, &ru) < 0) {
+        if (errno != EINTR) {
+            status = -1;
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sample_mutex);
+        finished = true;
+    }
+    sample_cv.notify_all();
+    sampler.join();
+
+    // wait4 folds in the CPU time of every descendant the shell reaped
+    usage.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    usage.cpu_seconds = timeval_seconds(ru.ru_utime) + timeval_seconds(ru.ru_stime);
+    // A process shorter than one sample interval can still be the peak
+    usage.peak_rss_kb = std::max(peak_kb, static_cast<long>(ru.ru_maxrss));
+    usage.status = status;
+
+    if (capture >= 0) {
+        CapturedOutput captured = InstallLogs::instance().detach(capture);
+        if (output) *output = captured;
+    }
+    return status;
+}
+
+InstallScheduler& InstallScheduler::instance() {
+    static InstallScheduler scheduler;
+    return scheduler;
+}
+
+InstallScheduler::InstallScheduler() {
+    max_running_ = default_jobs();
+    if (const char* env = getenv("VC_MAX_INSTALLS"); env && atoi(env) > 0) {
+        max_running_ = static_cast<unsigned>(atoi(env));
+    }
+
+    std::ifstream in(history_path());
+    std::string pkg;
+    long kb;
+    while (in >> pkg >> kb) {
+        history_kb_[pkg] = kb;
+    }
+}
+
+long InstallScheduler::predicted_kb(const std::string& pkg) const {
+    auto it = history_kb_.find(pkg);
+    return it != history_kb_.end() ? it->second : DEFAULT_INSTALL_KB;
+}
+
+// Block until there is room to run an install of pkg; returns the slot to release
+int InstallScheduler::acquire(const std::string& pkg) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    long need = predicted_kb(pkg);
+    bool announced = false;
+    while (true) {
+        // Running installs have not necessarily reached their peak yet, so count their reservations
+        long available = available_memory_kb();
+        bool memory_ok = available < 0 || available - reserved_kb_ - RESERVE_KB >= need;
+        if (running_ == 0 || (running_ < max_running_ && memory_ok)) break;
+        if (!announced) {
+            std::cout << "Waiting for memory or cores before installing '" << pkg << "'..." << std::endl;
+            announced = true;
+        }
+        cv_.wait_for(lock, std::chrono::seconds(1));
+    }
+    running_++;
+    reserved_kb_ += need;
+    // Per slot: the same package may be installed into two projects at once
+    int slot = next_slot_++;
+    reservations_[slot] = need;
+    return slot;
+}
+
+// Release a slot taken by acquire and record what the install used
+void InstallScheduler::release(int slot, const InstallUsage& usage) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_--;
+        reserved_kb_ -= reservations_[slot];
+        reservations_.erase(slot);
+        finished_.push_back(usage);
+        if (usage.status == 0 && usage.peak_rss_kb > 0) {
+            history_kb_[usage.package] = usage.peak_rss_kb;
+        }
+    }
+    cv_.notify_all();
+    if (usage.status == 0 && usage.peak_rss_kb > 0) {
+        save_history(usage);
+    }
+}
+
+void InstallScheduler::save_history(const InstallUsage& usage) {
+    fs::path path = history_path();
+    FileLock lock(vc_cache_dir() / "install_stats.lock");
+
+    // Merge with the file so concurrent vc processes do not drop each other's entries
+    std::map<std::string, long> merged;
+    std::ifstream in(path);
+    std::string pkg;
+    long kb;
+    while (in >> pkg >> kb) merged[pkg] = kb;
+    merged[usage.package] = usage.peak_rss_kb;
+
+    std::string content;
+    for (const auto& [name, peak] : merged) content += name + " " + std::to_string(peak) + "\n";
+    write_file_atomic(path, content);
+}
+
+// Usage of every install run by this process so far
+std::vector<InstallUsage> InstallScheduler::report() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_;
+}
+
+// Print a per-package table of wall time, CPU time and peak memory
+void print_install_report(const std::vector<InstallUsage>& usages) {
+    if (usages.empty()) return;
+    std::cout << "Install resource usage:" << std::endl;
+    for (const auto& usage : usages) {
+        char line[256];
+        snprintf(line, sizeof(line), "  %-24s wall %8.1fs  cpu %8.1fs  peak %8.1f MiB  %s",
+                 usage.package.c_str(), usage.wall_seconds, usage.cpu_seconds,
+                 static_cast<double>(usage.peak_rss_kb) / 1024.0, usage.status == 0 ? "ok" : "failed");
+        std::cout << line << std::endl;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "virtualc_common.h"
+#include "virtualc_logs.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+// Resources consumed by one install script, including every process it waited for
+struct InstallUsage {
+    std::string package;
+    int status = 0;
+    double wall_seconds = 0;
+    double cpu_seconds = 0;
+    long peak_rss_kb = 0;
+    std::vector<std::pair<std::string, double>> stages;  // seconds spent reaching each checkpoint
+};
+
+// Run a shell command and collect its resource usage: CPU time from wait4, and peak
+// memory as the largest sum of resident memory over the command and its descendants.
+// With log_base set, its stdout and stderr are captured into a compressed log there
+// instead of reaching the terminal, and output receives the log and last lines
+int run_command_with_usage(const std::string& command, InstallUsage& usage,
+                           const fs::path& log_base = {}, CapturedOutput* output = nullptr);
+
+// Admits install scripts based on free cores and available memory, so concurrent
+// heavy builds queue instead of being OOM-killed
+class InstallScheduler {
+public:
+    static InstallScheduler& instance();
+
+    // Block until there is room to run an install of pkg; returns the slot to release
+    int acquire(const std::string& pkg);
+
+    // Release a slot taken by acquire and record what the install used
+    void release(int slot, const InstallUsage& usage);
+
+    // Usage of every install run by this process so far
+    std::vector<InstallUsage> report();
+
+private:
+    InstallScheduler();
+    long predicted_kb(const std::string& pkg) const;
+    void save_history(const InstallUsage& usage);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    unsigned max_running_;
+    unsigned running_ = 0;
+    long reserved_kb_ = 0;
+    std::map<std::string, long> history_kb_;
+    int next_slot_ = 0;
+    std::map<int, long> reservations_;  // slot -> memory reserved for it
+    std::vector<InstallUsage> finished_;
+};
+
+// Print a per-package table of wall time, CPU time and peak memory
+void print_install_report(const std::vector<InstallUsage>& usages);
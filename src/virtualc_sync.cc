@@ -0,0 +1,143 @@
+#include "virtualc_sync.h"
+#include "virtualc_install.h"
+#include "virtualc_lock.h"
+#include "virtualc_scheduler.h"
+#include <map>
+#include <mutex>
+
+namespace {
+
+enum class SyncAction { None, Register, Install };
+
+// Check that the files a locked package resolves to are still on disk
+bool is_locked_package_intact(const LockEntry& entry) {
+    std::error_code ec;
+    if (entry.source == "script") {
+        if (entry.prefix.empty() || !fs::is_directory(entry.prefix, ec)) return false;
+        if (!entry.prefix_hash.empty() && hash_prefix(entry.prefix) != entry.prefix_hash) return false;
+    }
+    for (const auto& include : entry.includes) {
+        if (!fs::is_directory(include, ec)) return false;
+    }
+    for (const auto& path : entry.libpaths) {
+        if (!fs::is_directory(path, ec)) return false;
+    }
+    return true;
+}
+
+// Check that .libpath records exactly what the lock resolved
+bool matches_libpath(const LockEntry& entry, const LibpathEntry& current) {
+    return entry.version == current.version && entry.includes == current.includes &&
+           entry.libnames == current.libnames && entry.libpaths == current.libpaths;
+}
+
+} // namespace
+
+// Implement sync subcommand
+int sync_main(int argc, char** argv) {
+    cxxopts::Options options("vc sync", "Install and remove packages to match cproject.lock");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("j,jobs", "Number of packages to install concurrently", cxxopts::value<unsigned>()->default_value("0"));
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    fs::path cwd = fs::current_path();
+    fs::path tomlfile = cwd / "cproject.toml";
+    fs::path libpath = cwd / ".libpath";
+    fs::path lockfile = cwd / "cproject.lock";
+
+    if (!fs::exists(lockfile)) {
+        std::cerr << "Error: cproject.lock not found. Install packages with 'vc install' first." << std::endl;
+        return 1;
+    }
+    if (!fs::exists(tomlfile)) {
+        std::cout << "Project not initialized. Initializing..." << std::endl;
+        create_project(cwd, std::nullopt, std::nullopt);
+    }
+
+    std::vector<LockEntry> locked = read_lockfile(lockfile);
+    std::map<std::string, LibpathEntry> current;
+    for (auto& entry : read_libpath_entries(libpath)) {
+        current[entry.name] = entry;
+    }
+
+    // 1. Classify every locked package in parallel
+    std::vector<SyncAction> actions(locked.size(), SyncAction::None);
+    parallel_for(locked.size(), [&](size_t i) {
+        if (!is_locked_package_intact(locked[i])) {
+            actions[i] = SyncAction::Install;
+        } else {
+            auto it = current.find(locked[i].name);
+            if (it == current.end() || !matches_libpath(locked[i], it->second)) {
+                actions[i] = SyncAction::Register;
+            }
+        }
+    });
+
+    // 2. Remove packages that are no longer locked
+    std::set<std::string> locked_names;
+    for (const auto& entry : locked) locked_names.insert(entry.name);
+    size_t removed = 0;
+    for (const auto& [name, entry] : current) {
+        if (locked_names.count(name)) continue;
+        std::cout << "Removing package not in cproject.lock: " << name << std::endl;
+        remove_package_from_libpath(libpath, name);
+        remove_dependency_toml(tomlfile, name);
+        fs::path pkg_dir = cwd / ".venv" / name;
+        std::error_code ec;
+        if (fs::is_directory(pkg_dir, ec)) {
+            fs::remove_all(pkg_dir, ec);
+            if (ec) std::cerr << "Warning: Failed to remove " << pkg_dir << ": " << ec.message() << std::endl;
+        }
+        removed++;
+    }
+
+    // 3. Re-register packages whose files are intact but whose .libpath entry is stale
+    std::vector<size_t> to_install;
+    size_t registered = 0;
+    size_t up_to_date = 0;
+    for (size_t i = 0; i < locked.size(); ++i) {
+        const LockEntry& entry = locked[i];
+        if (actions[i] == SyncAction::Install) {
+            to_install.push_back(i);
+        } else if (actions[i] == SyncAction::Register) {
+            append_libpath(libpath, entry.name, entry.version, entry.includes, entry.libnames, entry.libpaths);
+            add_dependency_toml(tomlfile, entry.name, entry.version);
+            registered++;
+        } else {
+            up_to_date++;
+        }
+    }
+
+    // 4. Reinstall missing or drifted packages concurrently with their recorded arguments
+    std::mutex failed_mutex;
+    std::vector<std::string> failed;
+    parallel_for(to_install.size(), [&](size_t n) {
+        const LockEntry& entry = locked[to_install[n]];
+        if (entry.source == "script" && entry.script_hash != hash_file(custom_script_path(entry.name))) {
+            std::cerr << "Warning: install script for '" << entry.name << "' changed since it was locked." << std::endl;
+        }
+        remove_package_from_libpath(libpath, entry.name);
+        std::cout << "Installing package: " << entry.name << std::endl;
+        if (!install_package(entry.name, entry.arguments)) {
+            std::lock_guard<std::mutex> guard(failed_mutex);
+            failed.push_back(entry.name);
+        }
+    }, result["jobs"].as<unsigned>());
+
+    print_install_report(InstallScheduler::instance().report());
+    std::cout << "Sync complete: " << up_to_date << " up to date, " << registered << " registered, "
+              << (to_install.size() - failed.size()) << " installed, " << removed << " removed." << std::endl;
+    if (!failed.empty()) {
+        for (const auto& name : failed) {
+            std::cerr << "Failed to install '" << name << "'." << std::endl;
+        }
+        return 1;
+    }
+    return 0;
+}
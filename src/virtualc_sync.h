@@ -0,0 +1,6 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Bring .libpath and .venv in line with cproject.lock
+int sync_main(int argc, char** argv);
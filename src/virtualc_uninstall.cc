@@ -1,4 +1,5 @@
 #include "virtualc_uninstall.h"
+#include "virtualc_lock.h"
 
 // Implement uninstall subcommand to handle multiple packages
 int uninstall_main(const std::vector<std::string>& packages) {
@@ -33,8 +34,9 @@ int uninstall_main(const std::vector<std::string>& packages) {
             continue;
         }
         
-        // Remove from cproject.toml
+        // Remove from cproject.toml and cproject.lock
         remove_dependency_toml(tomlfile, pkg);
+        remove_lockfile_entry(cwd / "cproject.lock", pkg);
         
         // 4. Check if package directory exists in .venv and remove it
         if (fs::exists(pkg_dir) && fs::is_directory(pkg_dir)) {
@@ -0,0 +1,350 @@
+#include "virtualc_unity.h"
+#include "virtualc_worker.h"
+#include "virtualc_compiler.h"
+#include <map>
+#include <mutex>
+
+namespace {
+
+// A jumbo file stops growing past this many bytes of source, so no group becomes a straggler
+const uintmax_t MAX_GROUP_BYTES = 512 * 1024;
+// Each group should amortize the shared headers over at least this many files
+const size_t MIN_GROUP_FILES = 4;
+// Group id of sources that are compiled on their own
+const int SOLO = -1;
+
+struct UnitySource {
+    fs::path path;
+    std::string lang;  // "c" or "cc"; languages are never mixed in one jumbo file
+    uintmax_t bytes = 0;
+    std::set<std::string> statics;
+    int group = SOLO;
+};
+
+struct CompileTask {
+    fs::path source;
+    fs::path object;
+    std::vector<fs::path> members;  // sources a jumbo file includes; empty for solo compiles
+};
+
+// Utility: names declared "static" at namespace scope, including indented and
+// "static inline" ones inside namespace and extern "C" blocks. Braces are
+// tracked line by line, so statics in functions and classes are skipped; the
+// name is the identifier right before the first '(', '=', ';', '[' or '{' on
+// the line. Definitions in anonymous namespaces and declarations whose name
+// is on a later line are not seen: a jumbo file they break is retried file by file
+std::set<std::string> file_static_symbols(const fs::path& path) {
+    std::set<std::string> symbols;
+    std::ifstream in(path);
+    std::string line;
+    std::vector<bool> scopes;  // open braces, true for namespace-like bodies
+    bool namespace_next = false;
+    while (std::getline(in, line)) {
+        std::string code = trim(line.substr(0, line.find("//")));
+        bool namespace_scope = std::all_of(scopes.begin(), scopes.end(), [](bool ns) { return ns; });
+        if (namespace_scope && code.rfind("static", 0) == 0 && code.size() > 6 &&
+            isspace(static_cast<unsigned char>(code[6]))) {
+            size_t stop = code.find_first_of("(=;[{");
+            if (stop != std::string::npos) {
+                size_t end = stop;
+                while (end > 0 && isspace(static_cast<unsigned char>(code[end - 1]))) end--;
+                size_t begin = end;
+                while (begin > 0 && (isalnum(static_cast<unsigned char>(code[begin - 1])) || code[begin - 1] == '_')) begin--;
+                if (begin < end) symbols.insert(code.substr(begin, end - begin));
+            }
+        }
+        // The brace of "namespace x" may be on the next line
+        if (code.rfind("namespace", 0) == 0 || code.rfind("inline namespace", 0) == 0 ||
+            code.rfind("extern \"C\"", 0) == 0) {
+            namespace_next = true;
+        }
+        for (char c : code) {
+            if (c == '{') {
+                scopes.push_back(namespace_next);
+                namespace_next = false;
+            } else if (c == '}' && !scopes.empty()) {
+                scopes.pop_back();
+            } else if (c == ';') {
+                namespace_next = false;
+            }
+        }
+    }
+    return symbols;
+}
+
+bool collides(const std::set<std::string>& a, const std::set<std::string>& b) {
+    for (const auto& symbol : a) {
+        if (b.count(symbol)) return true;
+    }
+    return false;
+}
+
+// Cached groupings: "groups <lang> <count>" headers, then "<lang> <group> <path>" lines
+struct GroupCache {
+    std::map<std::string, int> counts;
+    std::map<std::string, int> groups;
+};
+
+GroupCache read_group_cache(const fs::path& file) {
+    GroupCache cache;
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        std::string first, lang, path;
+        int value;
+        if (!(iss >> first)) continue;
+        if (first == "groups") {
+            if (iss >> lang >> value) cache.counts[lang] = value;
+        } else if (iss >> value && iss.get() == ' ' && std::getline(iss, path)) {
+            cache.groups[path] = value;
+        }
+    }
+    return cache;
+}
+
+// Assign sources of one language to groups, keeping cached assignments where they still fit
+void assign_groups(std::vector<UnitySource*>& sources, const GroupCache& cache, const std::string& lang, int& group_count) {
+    uintmax_t total = 0;
+    for (auto* source : sources) total += source->bytes;
+    size_t by_size = static_cast<size_t>((total + MAX_GROUP_BYTES - 1) / MAX_GROUP_BYTES);
+    size_t by_cores = std::min<size_t>(default_jobs(), (sources.size() + MIN_GROUP_FILES - 1) / MIN_GROUP_FILES);
+    group_count = static_cast<int>(std::clamp<size_t>(std::max(by_size, by_cores), 1, sources.size()));
+
+    std::vector<uintmax_t> group_bytes(group_count, 0);
+    std::vector<std::set<std::string>> group_statics(group_count);
+    auto place = [&](UnitySource* source, int group) {
+        source->group = group;
+        group_bytes[group] += source->bytes;
+        group_statics[group].insert(source->statics.begin(), source->statics.end());
+    };
+
+    // Keep cached assignments when the group count is unchanged and nothing collides
+    std::vector<UnitySource*> pending;
+    auto count_it = cache.counts.find(lang);
+    bool reuse = count_it != cache.counts.end() && count_it->second == group_count;
+    for (auto* source : sources) {
+        auto cached = cache.groups.find(source->path.string());
+        if (reuse && cached != cache.groups.end() && cached->second == SOLO) {
+            source->group = SOLO;
+        } else if (reuse && cached != cache.groups.end() && cached->second < group_count &&
+                   !collides(source->statics, group_statics[cached->second])) {
+            place(source, cached->second);
+        } else {
+            pending.push_back(source);
+        }
+    }
+
+    // Everything else goes to the lightest group it does not collide with
+    std::sort(pending.begin(), pending.end(), [](const UnitySource* a, const UnitySource* b) { return a->path < b->path; });
+    for (auto* source : pending) {
+        int best = SOLO;
+        for (int g = 0; g < group_count; ++g) {
+            if (collides(source->statics, group_statics[g])) continue;
+            if (best == SOLO || group_bytes[g] < group_bytes[best]) best = g;
+        }
+        if (best == SOLO) {
+            std::cout << "unity: " << source->path.filename().string()
+                      << " shares static names with every group; compiling it separately" << std::endl;
+            source->group = SOLO;
+        } else {
+            place(source, best);
+        }
+    }
+}
+
+// Compile one task unless its object is up to date; returns the compiler's exit status
+int compile_task(const std::string& compiler, const std::vector<std::string>& compile_flags,
+                 const std::vector<std::string>& workers, const CompileTask& task, std::mutex& output_mutex) {
+    std::string cmd = compiler;
+    for (const auto& flag : compile_flags) cmd += " " + shell_quote(flag);
+    cmd += " -c " + shell_quote(task.source.string()) + " -o " + shell_quote(task.object.string());
+
+    fs::path depfile = fs::path(task.object).replace_extension(".d");
+    fs::path cmdfile = fs::path(task.object).replace_extension(".cmd");
+    std::vector<fs::path> inputs = {task.source};
+    inputs.insert(inputs.end(), task.members.begin(), task.members.end());
+    std::string recorded_cmd = fingerprinted_command(compiler, cmd);
+    if (is_up_to_date(task.object, inputs, depfile, cmdfile, recorded_cmd)) return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        if (task.members.empty()) {
+            std::cout << "Compiling " << task.source.filename().string() << std::endl;
+        } else {
+            std::cout << "Compiling " << task.source.filename().string() << " (" << task.members.size() << " files)" << std::endl;
+        }
+    }
+    fs::remove(cmdfile);
+
+    // Workers get the preprocessed source; anything they cannot take is compiled here
+    std::string diagnostics, worker;
+    if (compile_remote(workers, compiler, compile_flags, task.source, task.object, depfile, diagnostics, worker)) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << "  " << task.source.filename().string() << " compiled on " << worker << std::endl;
+        std::cerr << diagnostics;
+        create_file(cmdfile, recorded_cmd + "\n");
+        return 0;
+    }
+
+    int result = std::system((cmd + " -MMD -MF " + shell_quote(depfile.string())).c_str());
+    if (result == 0) create_file(cmdfile, recorded_cmd + "\n");
+    return result;
+}
+
+// Run tasks in parallel; returns the indices of the ones that failed
+std::vector<size_t> compile_tasks(const std::string& compiler, const std::vector<std::string>& compile_flags,
+                                  const std::vector<std::string>& workers, const std::vector<CompileTask>& tasks) {
+    std::mutex output_mutex;
+    std::vector<int> results(tasks.size(), 0);
+    // With workers, run as many jobs as the pool and this machine can take together
+    unsigned jobs = default_jobs() * static_cast<unsigned>(1 + workers.size());
+    parallel_for(tasks.size(), [&](size_t i) {
+        results[i] = compile_task(compiler, compile_flags, workers, tasks[i], output_mutex);
+    }, jobs);
+    std::vector<size_t> failed;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (results[i] != 0) failed.push_back(i);
+    }
+    return failed;
+}
+
+} // namespace
+
+// Compile sources as cached jumbo translation units (or one object per source when
+// group_sources is false), fanning compiles out to workers, and link them into output
+int unity_build(const std::string& compiler, const std::vector<fs::path>& sources,
+                const std::vector<std::string>& flags, const fs::path& output, const fs::path& root,
+                bool group_sources, const std::vector<std::string>& workers) {
+    // Everything is per output, so building another program from the same
+    // directory, even concurrently, leaves this one's groups and objects alone
+    fs::path unity_dir = vc_state_dir(root) / "unity" / hash_string(output.string());
+    fs::path object_dir = unity_dir / "obj";
+    fs::create_directories(object_dir);
+    fs::path cache_file = unity_dir / "groups";
+
+    std::vector<std::string> compile_flags, link_flags;
+    split_compiler_args(flags, compile_flags, link_flags);
+
+    // Scan sources once: size and file-scope static names
+    std::vector<UnitySource> units(sources.size());
+    parallel_for(sources.size(), [&](size_t i) {
+        std::error_code ec;
+        units[i].path = sources[i];
+        units[i].lang = sources[i].extension() == ".c" ? "c" : "cc";
+        units[i].bytes = fs::file_size(sources[i], ec);
+        if (group_sources) units[i].statics = file_static_symbols(sources[i]);
+    });
+
+    GroupCache cache = read_group_cache(cache_file);
+    std::map<std::string, std::vector<UnitySource*>> by_lang;
+    for (auto& unit : units) by_lang[unit.lang].push_back(&unit);
+    std::map<std::string, int> group_counts;
+    for (auto& [lang, members] : by_lang) {
+        if (group_sources) assign_groups(members, cache, lang, group_counts[lang]);
+    }
+
+    // Write the jumbo files, touching only the ones whose contents changed
+    std::vector<CompileTask> tasks;
+    for (auto& [lang, count] : group_counts) {
+        for (int g = 0; g < count; ++g) {
+            CompileTask task;
+            task.source = unity_dir / ("unity_" + lang + "_" + std::to_string(g) + "." + lang);
+            task.object = object_dir / ("unity_" + lang + "_" + std::to_string(g) + ".o");
+            for (const auto* unit : by_lang[lang]) {
+                if (unit->group == g) task.members.push_back(unit->path);
+            }
+            if (task.members.empty()) continue;
+            std::sort(task.members.begin(), task.members.end());
+            std::string content = "/* Generated by vc run --unity; do not edit */\n";
+            for (const auto& member : task.members) content += "#include \"" + member.string() + "\"\n";
+            if (read_file(task.source) != content) write_file_atomic(task.source, content);
+            tasks.push_back(task);
+        }
+    }
+    for (const auto& unit : units) {
+        if (unit.group != SOLO) continue;
+        tasks.push_back({unit.path, object_dir / (hash_string(unit.path.string()) + ".o"), {}});
+    }
+
+    std::vector<size_t> failed = compile_tasks(compiler, compile_flags, workers, tasks);
+
+    // A failing jumbo file is retried file by file; if that succeeds, the
+    // grouping was the problem and its members stay separate from now on
+    std::vector<CompileTask> fallback;
+    std::set<size_t> failed_jumbo;
+    for (size_t i : failed) {
+        if (tasks[i].members.empty()) {
+            std::cerr << "Compilation failed." << std::endl;
+            return 1;
+        }
+        std::cerr << "unity: " << tasks[i].source.filename().string() << " failed; compiling its files separately" << std::endl;
+        failed_jumbo.insert(i);
+        for (const auto& member : tasks[i].members) {
+            fallback.push_back({member, object_dir / (hash_string(member.string()) + ".o"), {}});
+        }
+    }
+    if (!compile_tasks(compiler, compile_flags, workers, fallback).empty()) {
+        std::cerr << "Compilation failed." << std::endl;
+        return 1;
+    }
+    for (size_t i : failed_jumbo) {
+        for (auto& unit : units) {
+            if (std::find(tasks[i].members.begin(), tasks[i].members.end(), unit.path) != tasks[i].members.end()) {
+                unit.group = SOLO;
+            }
+        }
+    }
+
+    if (group_sources) {
+        std::ostringstream groups;
+        for (const auto& [lang, count] : group_counts) groups << "groups " << lang << " " << count << "\n";
+        for (const auto& unit : units) groups << unit.lang << " " << unit.group << " " << unit.path.string() << "\n";
+        write_file_atomic(cache_file, groups.str());
+    }
+
+    // Link every object; the depfile lists them so the link is skipped when none changed
+    std::vector<fs::path> objects;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (!failed_jumbo.count(i)) objects.push_back(tasks[i].object);
+    }
+    for (const auto& task : fallback) objects.push_back(task.object);
+
+    std::string cmd = compiler;
+    for (const auto& object : objects) cmd += " " + shell_quote(object.string());
+    for (const auto& flag : flags) cmd += " " + shell_quote(flag);
+    cmd += " -o " + shell_quote(output.string());
+
+    fs::path depfile = unity_dir / "link.d";
+    fs::path cmdfile = unity_dir / "link.cmd";
+    std::string recorded_cmd = fingerprinted_command(compiler, cmd);
+    if (is_up_to_date(output, {}, depfile, cmdfile, recorded_cmd)) {
+        std::cout << output.filename().string() << " is up to date." << std::endl;
+        return 0;
+    }
+
+    std::cout << "Linking " << output.filename().string() << " from " << objects.size() << " objects" << std::endl;
+    fs::remove(cmdfile);
+    int result = std::system(cmd.c_str());
+    if (result != 0) {
+        std::cerr << "Linking failed." << std::endl;
+        return result;
+    }
+    std::string deps = output.string() + ":";
+    for (const auto& object : objects) deps += " " + object.string();
+    create_file(depfile, deps + "\n");
+    create_file(cmdfile, recorded_cmd + "\n");
+    std::cout << "Compilation successful." << std::endl;
+    return 0;
+}
+
+// Split DWARF .dwo files of the objects the last unity_build of output linked
+std::vector<fs::path> unity_dwo_files(const fs::path& output, const fs::path& root) {
+    std::vector<fs::path> files;
+    fs::path depfile = vc_state_dir(root) / "unity" / hash_string(output.string()) / "link.d";
+    for (const auto& object : read_depfile(depfile)) {
+        fs::path dwo = fs::path(object).replace_extension(".dwo");
+        if (fs::exists(dwo)) files.push_back(dwo);
+    }
+    return files;
+}
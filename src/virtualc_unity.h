@@ -0,0 +1,12 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Compile sources as cached jumbo translation units (or one object per source when
+// group_sources is false), fanning compiles out to workers, and link them into output
+int unity_build(const std::string& compiler, const std::vector<fs::path>& sources,
+                const std::vector<std::string>& flags, const fs::path& output, const fs::path& root,
+                bool group_sources = true, const std::vector<std::string>& workers = {});
+
+// Split DWARF .dwo files of the objects the last unity_build of output linked
+std::vector<fs::path> unity_dwo_files(const fs::path& output, const fs::path& root);
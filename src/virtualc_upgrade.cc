@@ -1,4 +1,5 @@
 #include "virtualc_upgrade.h"
+#include "virtualc_index.h"
 
 // Function to upgrade the libs directory
 int upgrade_libs_main() {
@@ -12,11 +13,26 @@ int upgrade_libs_main() {
         return 1;
     }
     
-    // Clone the repository
-    std::string clone_cmd = "git clone https://github.com/powdersnow0604/linux_scripts.git " + temp_dir;
-    std::cout << "Cloning repository..." << std::endl;
-    if (system(clone_cmd.c_str()) != 0) {
-        std::cerr << "Error: Failed to clone repository" << std::endl;
+    // Fetch the scripts from the configured mirror, else the repository vc was built with
+    MirrorConfig mirror = read_mirror_config();
+    std::string source = mirror.scripts.empty() ? VIRTUALC_SCRIPTS_REPO : mirror.scripts;
+    if (mirror.offline && is_network_url(source)) {
+        std::cerr << "Error: Offline mode refuses to fetch scripts from " << source << std::endl;
+        std::cerr << "Set [mirror] scripts in " << vc_config_path() << " to a local directory or repository" << std::endl;
+        return 1;
+    }
+
+    // A plain directory (e.g. an rsynced checkout) is copied; anything else goes through git
+    std::string fetch_cmd;
+    if (std::filesystem::is_directory(source) && !std::filesystem::exists(std::filesystem::path(source) / ".git")) {
+        fetch_cmd = "cp -r " + shell_quote(source) + "/. " + temp_dir;
+        std::cout << "Copying scripts from " << source << "..." << std::endl;
+    } else {
+        fetch_cmd = "git clone --depth 1 " + shell_quote(source) + " " + temp_dir;
+        std::cout << "Cloning repository " << source << "..." << std::endl;
+    }
+    if (system(fetch_cmd.c_str()) != 0) {
+        std::cerr << "Error: Failed to fetch library scripts from " << source << std::endl;
         return 1;
     }
     
@@ -58,6 +74,11 @@ int upgrade_libs_main() {
         }
     }
     
+    // Index the scripts before copying so the index ships alongside them
+    if (!build_script_index(temp_dir + "/libs", temp_dir + "/libs/.vcindex")) {
+        std::cerr << "Warning: Failed to build script index; 'vc search' will index on first use" << std::endl;
+    }
+
     // Create libs directory
     std::string mkdir_libs_cmd = "sudo mkdir -p " + libs_dir;
     if (system(mkdir_libs_cmd.c_str()) != 0) {
@@ -65,8 +86,8 @@ int upgrade_libs_main() {
         return 1;
     }
     
-    // Copy the libs directory from the cloned repository
-    std::string cp_cmd = "sudo cp -r " + temp_dir + "/libs/* " + libs_dir;
+    // Copy the libs directory from the cloned repository, dotfiles included
+    std::string cp_cmd = "sudo cp -r " + temp_dir + "/libs/. " + libs_dir;
     if (system(cp_cmd.c_str()) != 0) {
         std::cerr << "Error: Failed to copy libs directory" << std::endl;
         return 1;
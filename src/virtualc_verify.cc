@@ -0,0 +1,261 @@
+#include "virtualc_verify.h"
+#include "virtualc_hash.h"
+#include "virtualc_install.h"
+#include "virtualc_lock.h"
+#include "virtualc_modules.h"
+#include "virtualc_compiler.h"
+#include <map>
+
+namespace {
+
+struct ManifestFile {
+    std::string hash;
+    uintmax_t size = 0;
+};
+
+struct PackageCheck {
+    std::string name;
+    fs::path prefix;
+    std::map<std::string, ManifestFile> manifest;
+    std::vector<std::string> files;   // relative paths currently under prefix
+    std::vector<std::string> hashes;  // parallel to files
+    std::vector<std::string> modified, missing, added;
+    bool incompatible = false;        // built for another target than the project compiler's
+};
+
+fs::path manifest_path(const fs::path& root, const std::string& pkg) {
+    fs::path dir = vc_state_dir(root) / "manifests";
+    fs::create_directories(dir);
+    return dir / pkg;
+}
+
+// Relative paths of every regular file under prefix
+std::vector<std::string> list_prefix_files(const fs::path& prefix) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(prefix, fs::directory_options::skip_permission_denied, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        // Prebuilt header units are derived from the package, not part of it
+        if (it->is_directory(ec) && it->path().filename() == BMI_DIR_NAME) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (it->is_regular_file(ec) && !it->is_symlink(ec)) {
+            files.push_back(fs::relative(it->path(), prefix).string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Read a manifest written by write_install_manifest
+std::map<std::string, ManifestFile> read_manifest(const fs::path& path) {
+    std::map<std::string, ManifestFile> manifest;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        ManifestFile file;
+        std::string rel;
+        if (!(iss >> file.hash >> file.size)) continue;
+        std::getline(iss >> std::ws, rel);
+        if (!rel.empty()) manifest[rel] = file;
+    }
+    return manifest;
+}
+
+// Print up to a few paths of one drift category
+void print_paths(const std::string& label, const std::vector<std::string>& paths) {
+    const size_t limit = 10;
+    for (size_t i = 0; i < paths.size() && i < limit; ++i) {
+        std::cout << "    " << label << ": " << paths[i] << std::endl;
+    }
+    if (paths.size() > limit) {
+        std::cout << "    ... and " << (paths.size() - limit) << " more " << label << " file(s)" << std::endl;
+    }
+}
+
+} // namespace
+
+// Record the content hashes of every file under a freshly installed prefix
+void write_install_manifest(const fs::path& root, const std::string& pkg, const fs::path& prefix) {
+    std::vector<std::string> files = list_prefix_files(prefix);
+    std::vector<std::string> hashes(files.size());
+    HashCache cache(vc_state_dir(root) / "hashcache");
+    parallel_for(files.size(), [&](size_t i) {
+        hashes[i] = cache.hash(prefix / files[i]);
+    });
+    cache.save();
+
+    std::string content;
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::error_code ec;
+        content += hashes[i] + " " + std::to_string(fs::file_size(prefix / files[i], ec)) + " " + files[i] + "\n";
+    }
+    create_file(manifest_path(root, pkg), content);
+}
+
+// Rehash selected files of a package whose contents vc itself rewrote
+void refresh_install_manifest(const fs::path& root, const std::string& pkg, const fs::path& prefix,
+                              const std::vector<std::string>& rel_paths) {
+    fs::path manifest_file = manifest_path(root, pkg);
+    if (!fs::exists(manifest_file)) return;
+
+    std::map<std::string, ManifestFile> manifest = read_manifest(manifest_file);
+    for (const auto& rel : rel_paths) {
+        auto it = manifest.find(rel);
+        if (it == manifest.end()) continue;
+        std::error_code ec;
+        it->second.hash = hash_file(prefix / rel);
+        it->second.size = fs::file_size(prefix / rel, ec);
+    }
+
+    std::string content;
+    for (const auto& [rel, file] : manifest) {
+        content += file.hash + " " + std::to_string(file.size) + " " + rel + "\n";
+    }
+    create_file(manifest_file, content);
+}
+
+// Implement verify subcommand
+int verify_main(int argc, char** argv) {
+    cxxopts::Options options("vc verify", "Check installed packages against their install manifests");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("r,repair", "Reinstall packages whose files drifted")
+        ("packages", "Packages to verify (default: all)", cxxopts::value<std::vector<std::string>>());
+    options.parse_positional({"packages"});
+    options.positional_help("[PACKAGES...]");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    fs::path cwd = fs::current_path();
+    fs::path libpath = cwd / ".libpath";
+    if (!fs::exists(libpath)) {
+        std::cout << "No packages installed (missing .libpath file).\n";
+        return 0;
+    }
+
+    std::set<std::string> selected;
+    if (result.count("packages")) {
+        for (const auto& pkg : result["packages"].as<std::vector<std::string>>()) selected.insert(pkg);
+    }
+
+    std::map<std::string, LockEntry> locked;
+    for (auto& entry : read_lockfile(cwd / "cproject.lock")) locked[entry.name] = entry;
+
+    // 1. Collect packages that have a manifest and list their current files
+    std::vector<PackageCheck> checks;
+    for (const auto& entry : read_libpath_entries(libpath)) {
+        if (!selected.empty() && !selected.count(entry.name)) continue;
+        fs::path manifest_file = manifest_path(cwd, entry.name);
+        if (!fs::exists(manifest_file)) {
+            std::cout << entry.name << ": no install manifest (not installed from a script), skipped" << std::endl;
+            continue;
+        }
+        PackageCheck check;
+        check.name = entry.name;
+        auto it = locked.find(entry.name);
+        check.prefix = (it != locked.end() && !it->second.prefix.empty()) ? fs::path(it->second.prefix)
+                                                                          : fs::path(resolve_install_path(cwd, entry.name));
+        check.manifest = read_manifest(manifest_file);
+        check.files = list_prefix_files(check.prefix);
+        check.hashes.resize(check.files.size());
+        checks.push_back(std::move(check));
+    }
+
+    // Compare what built each package with the project compiler, from its cached fingerprint
+    std::string project_abi = compiler_fingerprint(get_compiler_path(cwd / "cproject.toml")).abi();
+    for (auto& check : checks) {
+        auto it = locked.find(check.name);
+        if (project_abi.empty() || it == locked.end() || it->second.abi.empty() || it->second.abi == project_abi) continue;
+        std::string built_target = it->second.abi.substr(0, it->second.abi.find(' '));
+        std::string project_target = project_abi.substr(0, project_abi.find(' '));
+        if (built_target != project_target) {
+            std::cout << check.name << ": INCOMPATIBLE (built for " << built_target << ", project compiler targets "
+                      << project_target << ")" << std::endl;
+            check.incompatible = true;
+        } else {
+            std::cout << check.name << ": built by " << it->second.abi << ", project compiler is " << project_abi
+                      << "; C++ libraries may need a reinstall" << std::endl;
+        }
+    }
+
+    // 2. Hash every file of every package across all cores
+    std::vector<std::pair<size_t, size_t>> tasks;
+    for (size_t p = 0; p < checks.size(); ++p) {
+        for (size_t f = 0; f < checks[p].files.size(); ++f) tasks.emplace_back(p, f);
+    }
+    HashCache cache(vc_state_dir(cwd) / "hashcache");
+    parallel_for(tasks.size(), [&](size_t i) {
+        PackageCheck& check = checks[tasks[i].first];
+        check.hashes[tasks[i].second] = cache.hash(check.prefix / check.files[tasks[i].second]);
+    });
+    cache.save();
+
+    // 3. Compare with the manifests and report
+    std::vector<const PackageCheck*> drifted;
+    for (auto& check : checks) {
+        std::set<std::string> seen;
+        for (size_t f = 0; f < check.files.size(); ++f) {
+            seen.insert(check.files[f]);
+            auto it = check.manifest.find(check.files[f]);
+            if (it == check.manifest.end()) {
+                check.added.push_back(check.files[f]);
+            } else if (it->second.hash != check.hashes[f]) {
+                check.modified.push_back(check.files[f]);
+            }
+        }
+        for (const auto& [rel, file] : check.manifest) {
+            if (!seen.count(rel)) check.missing.push_back(rel);
+        }
+
+        if (check.modified.empty() && check.missing.empty() && check.added.empty()) {
+            if (check.incompatible) {
+                drifted.push_back(&check);
+            } else {
+                std::cout << check.name << ": OK (" << check.files.size() << " files)" << std::endl;
+            }
+            continue;
+        }
+        std::cout << check.name << ": DRIFTED (" << check.modified.size() << " modified, " << check.missing.size()
+                  << " missing, " << check.added.size() << " added)" << std::endl;
+        print_paths("modified", check.modified);
+        print_paths("missing", check.missing);
+        print_paths("added", check.added);
+        drifted.push_back(&check);
+    }
+
+    if (drifted.empty()) {
+        return 0;
+    }
+    if (!result.count("repair")) {
+        std::cerr << drifted.size() << " package(s) drifted or are incompatible. Run 'vc verify --repair' to reinstall them." << std::endl;
+        return 1;
+    }
+
+    // 4. Repair by reinstalling with the arguments recorded in cproject.lock
+    int status = 0;
+    for (const PackageCheck* check : drifted) {
+        auto it = locked.find(check->name);
+        if (it == locked.end() || it->second.source != "script") {
+            std::cerr << "Cannot repair '" << check->name << "': no script install recorded in cproject.lock." << std::endl;
+            status = 1;
+            continue;
+        }
+        std::cout << "Repairing package: " << check->name << std::endl;
+        remove_package_from_libpath(libpath, check->name);
+        std::error_code ec;
+        fs::remove_all(check->prefix, ec);
+        if (!install_package(check->name, it->second.arguments)) {
+            std::cerr << "Failed to repair '" << check->name << "'." << std::endl;
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Record the content hashes of every file under a freshly installed prefix
+void write_install_manifest(const fs::path& root, const std::string& pkg, const fs::path& prefix);
+
+// Rehash selected files of a package whose contents vc itself rewrote
+void refresh_install_manifest(const fs::path& root, const std::string& pkg, const fs::path& prefix,
+                              const std::vector<std::string>& rel_paths);
+
+// Check installed packages against their install manifests
+int verify_main(int argc, char** argv);
@@ -0,0 +1,442 @@
+#include "virtualc_worker.h"
+#include "virtualc_compiler.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <csignal>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Wire protocol: every message is a sequence of frames, each a 4-byte
+// big-endian length followed by that many bytes.
+//   request:  "VCW2", compiler name, compiler identity, language ("c" or "c++"),
+//             flags (NUL separated), preprocessed source
+//   response: exit status, compiler diagnostics, object file
+namespace {
+
+const char* PROTOCOL_MAGIC = "VCW2";
+const uint32_t MAX_FRAME = 256u * 1024 * 1024;
+const int IO_TIMEOUT_SECONDS = 300;
+const int CONNECT_TIMEOUT_SECONDS = 2;
+
+// Preprocessor options are applied locally and never sent; those taking a separate argument are listed here
+const std::set<std::string> PREPROCESSOR_PAIRED = {"-isystem", "-include", "-iquote", "-idirafter", "-imacros", "-MF", "-MT", "-MQ"};
+// Link-only options that are meaningless for -c and dropped
+const std::set<std::string> LINK_ONLY = {"-s", "-static", "-shared", "-rdynamic", "-pie", "-no-pie"};
+
+// Release and target of a compiler; a worker only compiles for clients whose
+// compiler matches, since the objects are linked with the client's runtime
+std::string compiler_identity(const std::string& compiler) {
+    const CompilerFingerprint& fingerprint = compiler_fingerprint(compiler);
+    return fingerprint.version + "\n" + fingerprint.target;
+}
+
+bool is_preprocessor_flag(const std::string& flag) {
+    for (const char* prefix : {"-I", "-D", "-U", "-M", "-isystem", "-include", "-iquote", "-idirafter", "-imacros"}) {
+        if (flag.rfind(prefix, 0) == 0) return true;
+    }
+    return flag == "-H" || flag == "-C";
+}
+
+// Code generation flags a worker accepts; anything that names files or loads code is refused
+bool is_worker_flag(const std::string& flag) {
+    if (flag == "-w" || flag == "-pipe" || flag == "-ansi" || flag == "-pthread") return true;
+    if (flag.rfind("-pedantic", 0) == 0 || flag.rfind("-std=", 0) == 0) return true;
+    // Split DWARF leaves a .dwo behind on the worker that never comes back
+    if (flag == "-gsplit-dwarf") return false;
+    if (flag.rfind("-O", 0) == 0 || flag.rfind("-g", 0) == 0 || flag.rfind("-m", 0) == 0) return true;
+    if (flag.rfind("-W", 0) == 0) {
+        return flag.rfind("-Wl,", 0) != 0 && flag.rfind("-Wa,", 0) != 0 && flag.rfind("-Wp,", 0) != 0;
+    }
+    if (flag.rfind("-f", 0) == 0) {
+        for (const char* refused : {"-fplugin", "-fmodule", "-fprofile", "-fdump", "-fauto-profile", "-fcoverage", "-fsave-optimization"}) {
+            if (flag.rfind(refused, 0) == 0) return false;
+        }
+        return flag.find('/') == std::string::npos;
+    }
+    return false;
+}
+
+// Compiler names a worker resolves in its own PATH: plain names only
+bool is_worker_compiler(const std::string& name) {
+    if (name.empty()) return false;
+    for (char c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '+' && c != '-' && c != '_' && c != '.') return false;
+    }
+    return true;
+}
+
+bool send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool recv_all(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = recv(fd, data, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool send_frame(int fd, const std::string& payload) {
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    unsigned char header[4] = {static_cast<unsigned char>(size >> 24), static_cast<unsigned char>(size >> 16),
+                               static_cast<unsigned char>(size >> 8), static_cast<unsigned char>(size)};
+    return send_all(fd, reinterpret_cast<const char*>(header), 4) && send_all(fd, payload.data(), payload.size());
+}
+
+bool recv_frame(int fd, std::string& payload) {
+    unsigned char header[4];
+    if (!recv_all(fd, reinterpret_cast<char*>(header), 4)) return false;
+    uint32_t size = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) | (uint32_t(header[2]) << 8) | header[3];
+    if (size > MAX_FRAME) return false;
+    payload.resize(size);
+    return recv_all(fd, payload.data(), size);
+}
+
+void set_timeouts(int fd, int seconds) {
+    struct timeval tv = {seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// Utility: strip the optional "unix:" scheme; true for Unix socket addresses
+bool unix_socket_path(const std::string& address, std::string& path) {
+    if (address.rfind("unix:", 0) == 0) {
+        path = address.substr(5);
+        return true;
+    }
+    if (!address.empty() && (address[0] == '/' || address[0] == '.')) {
+        path = address;
+        return true;
+    }
+    return false;
+}
+
+// Connect to a worker address; -1 on failure
+int connect_worker(const std::string& address) {
+    std::string path;
+    if (unix_socket_path(address, path)) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) { close(fd); return -1; }
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) { close(fd); return -1; }
+        set_timeouts(fd, IO_TIMEOUT_SECONDS);
+        return fd;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return -1;
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0) return -1;
+    int fd = -1;
+    for (auto* ai = results; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        // On Linux the send timeout also bounds connect, so a dead host is skipped quickly
+        set_timeouts(fd, CONNECT_TIMEOUT_SECONDS);
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(results);
+    if (fd >= 0) set_timeouts(fd, IO_TIMEOUT_SECONDS);
+    return fd;
+}
+
+// Next worker to try first, so concurrent jobs spread over the pool
+std::atomic<size_t> next_worker{0};
+
+} // namespace
+
+// Worker addresses from $VC_WORKERS or [project] workers (comma separated):
+// "unix:/path", "/path" or "host:port"
+std::vector<std::string> configured_workers(const fs::path& toml_file) {
+    std::string list;
+    if (const char* env = getenv("VC_WORKERS"); env) {
+        list = env;
+    } else {
+        list = get_project_setting(toml_file, "workers", "");
+    }
+    std::vector<std::string> workers;
+    std::istringstream iss(list);
+    std::string worker;
+    while (std::getline(iss, worker, ',')) {
+        worker = trim(worker);
+        if (!worker.empty()) workers.push_back(worker);
+    }
+    return workers;
+}
+
+// Preprocess source locally and compile it to object on one of the workers
+bool compile_remote(const std::vector<std::string>& workers, const std::string& compiler,
+                    const std::vector<std::string>& compile_flags, const fs::path& source,
+                    const fs::path& object, const fs::path& depfile,
+                    std::string& diagnostics, std::string& worker) {
+    if (workers.empty()) return false;
+
+    std::vector<std::string> split_compiler = split_flags(compiler);
+    std::string compiler_name = split_compiler.empty() ? "" : fs::path(split_compiler.back()).filename().string();
+    if (split_compiler.size() != 1 || !is_worker_compiler(compiler_name)) return false;
+    std::string identity = compiler_identity(compiler);
+
+    // Only code generation flags travel; everything the preprocessor needs stays here
+    std::string remote_flags;
+    for (size_t i = 0; i < compile_flags.size(); ++i) {
+        const std::string& flag = compile_flags[i];
+        if (PREPROCESSOR_PAIRED.count(flag)) { ++i; continue; }
+        if (is_preprocessor_flag(flag) || LINK_ONLY.count(flag)) continue;
+        if (!is_worker_flag(flag)) return false;
+        remote_flags += flag + '\0';
+    }
+
+    fs::path preprocessed = fs::path(object.string() + (source.extension() == ".c" ? ".i" : ".ii"));
+    std::string cmd = compiler;
+    for (const auto& flag : compile_flags) cmd += " " + shell_quote(flag);
+    cmd += " -E " + shell_quote(source.string()) + " -o " + shell_quote(preprocessed.string()) +
+           " -MMD -MF " + shell_quote(depfile.string()) + " -MT " + shell_quote(object.string());
+    if (std::system(cmd.c_str()) != 0) {
+        fs::remove(preprocessed);
+        return false;
+    }
+    std::string code = read_file(preprocessed);
+    fs::remove(preprocessed);
+
+    size_t start = next_worker++;
+    for (size_t attempt = 0; attempt < workers.size(); ++attempt) {
+        const std::string& address = workers[(start + attempt) % workers.size()];
+        int fd = connect_worker(address);
+        if (fd < 0) continue;
+
+        std::string status, stderr_text, object_bytes;
+        bool ok = send_frame(fd, PROTOCOL_MAGIC) && send_frame(fd, compiler_name) &&
+                  send_frame(fd, identity) && send_frame(fd, source.extension() == ".c" ? "c" : "c++") &&
+                  send_frame(fd, remote_flags) && send_frame(fd, code) &&
+                  recv_frame(fd, status) && recv_frame(fd, stderr_text) && recv_frame(fd, object_bytes);
+        close(fd);
+        if (!ok) continue;
+        if (status != "0") return false;
+
+        write_file_atomic(object, object_bytes);
+        diagnostics = stderr_text;
+        worker = address;
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+// Run argv with stderr captured; returns the exit status
+int run_captured(const std::vector<std::string>& args, const fs::path& stderr_file) {
+    // Everything is prepared before fork: the worker is multithreaded, so the child may not allocate
+    std::vector<char*> argv;
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+    int fd = open(stderr_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (fd >= 0) {
+            dup2(fd, STDERR_FILENO);
+            dup2(fd, STDOUT_FILENO);
+        }
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    if (fd >= 0) close(fd);
+    if (pid < 0) return -1;
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Connection slots: a connection may buffer up to MAX_FRAME per frame, so only
+// as many as there are compile jobs are served at once; the rest wait in the backlog
+class JobSlots {
+public:
+    explicit JobSlots(unsigned count) : free_(count) {}
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return free_ > 0; });
+        free_--;
+    }
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_++;
+        cv_.notify_one();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    unsigned free_;
+};
+
+// Serve one job on an accepted connection
+void handle_job(int fd, const fs::path& scratch) {
+    set_timeouts(fd, IO_TIMEOUT_SECONDS);
+    std::string magic, compiler_name, identity, lang, flags, code;
+    bool ok = recv_frame(fd, magic) && magic == PROTOCOL_MAGIC && recv_frame(fd, compiler_name) &&
+              recv_frame(fd, identity) && recv_frame(fd, lang) && recv_frame(fd, flags) && recv_frame(fd, code);
+    if (!ok) {
+        close(fd);
+        return;
+    }
+
+    auto reject = [&](const std::string& reason) {
+        send_frame(fd, "1") && send_frame(fd, "vc worker: " + reason + "\n") && send_frame(fd, "");
+        close(fd);
+    };
+    std::string compiler_path = is_worker_compiler(compiler_name) ? find_in_path(compiler_name) : "";
+    if (compiler_path.empty()) return reject("compiler '" + compiler_name + "' is not available");
+    if (compiler_identity(compiler_path) != identity) {
+        return reject("compiler '" + compiler_name + "' is a different release or target here");
+    }
+    if (lang != "c" && lang != "c++") return reject("unknown language '" + lang + "'");
+
+    std::vector<std::string> args = {compiler_path, "-x", lang == "c" ? "cpp-output" : "c++-cpp-output"};
+    size_t start = 0;
+    while (start < flags.size()) {
+        size_t end = flags.find('\0', start);
+        if (end == std::string::npos) end = flags.size();
+        std::string flag = flags.substr(start, end - start);
+        if (!flag.empty()) {
+            if (!is_worker_flag(flag)) return reject("flag '" + flag + "' is not accepted");
+            args.push_back(flag);
+        }
+        start = end + 1;
+    }
+
+    static std::atomic<unsigned long> job_counter{0};
+    std::string job = std::to_string(getpid()) + "-" + std::to_string(job_counter++);
+    fs::path input = scratch / (job + (lang == "c" ? ".i" : ".ii"));
+    fs::path output = scratch / (job + ".o");
+    fs::path log = scratch / (job + ".log");
+    create_file(input, code);
+    args.insert(args.end(), {"-c", input.string(), "-o", output.string()});
+
+    int status = run_captured(args, log);
+
+    send_frame(fd, std::to_string(status)) && send_frame(fd, read_file(log)) &&
+        send_frame(fd, status == 0 ? read_file(output) : "");
+    close(fd);
+    std::error_code ec;
+    fs::remove(input, ec);
+    fs::remove(output, ec);
+    fs::remove(log, ec);
+}
+
+// Bind and listen on a worker address; -1 on failure
+int listen_worker(const std::string& address) {
+    std::string path;
+    if (unix_socket_path(address, path)) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) { close(fd); return -1; }
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str());
+        // Workers run compilers on request, so only the owner may connect; listen only after the chmod
+        if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            chmod(path.c_str(), 0600) != 0 || listen(fd, 64) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return -1;
+    std::string host = address.substr(0, colon);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    // There is no authentication: ":port" binds loopback, other hosts must be named explicitly
+    hints.ai_flags = host.empty() ? 0 : AI_PASSIVE;
+    struct addrinfo* results = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), address.substr(colon + 1).c_str(), &hints, &results) != 0) return -1;
+    int fd = -1;
+    for (auto* ai = results; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(results);
+    return fd;
+}
+
+} // namespace
+
+// Implement worker subcommand
+int worker_main(int argc, char** argv) {
+    std::string default_socket = (fs::temp_directory_path() / ("vc-worker-" + std::to_string(getuid()) + ".sock")).string();
+    cxxopts::Options options("vc worker", "Serve preprocessed compile jobs for vc run");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("l,listen", "Address: unix:/path or [host]:port", cxxopts::value<std::string>()->default_value("unix:" + default_socket))
+        ("j,jobs", "Concurrent compiles", cxxopts::value<unsigned>()->default_value(std::to_string(default_jobs())));
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::string address = result["listen"].as<std::string>();
+    unsigned jobs = std::max(1u, result["jobs"].as<unsigned>());
+    int listen_fd = listen_worker(address);
+    if (listen_fd < 0) {
+        std::cerr << "Error: Cannot listen on " << address << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    fs::path scratch = vc_cache_dir() / "worker";
+    fs::create_directories(scratch);
+    signal(SIGPIPE, SIG_IGN);
+    std::cout << "vc worker listening on " << address << " with " << jobs << " jobs" << std::endl;
+
+    JobSlots slots(jobs);
+    while (true) {
+        slots.acquire();
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            slots.release();
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "Error: accept failed: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        std::thread([fd, scratch, &slots]() {
+            handle_job(fd, scratch);
+            slots.release();
+        }).detach();
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Worker addresses from $VC_WORKERS or [project] workers (comma separated):
+// "unix:/path", "/path" or "host:port"
+std::vector<std::string> configured_workers(const fs::path& toml_file);
+
+// Preprocess source locally and compile it to object on one of the workers,
+// writing a depfile like -MMD would. Returns false when the job has to be
+// compiled locally: flags a worker does not accept, no reachable worker, or a
+// failed remote compile (so errors always come from the local compiler).
+bool compile_remote(const std::vector<std::string>& workers, const std::string& compiler,
+                    const std::vector<std::string>& compile_flags, const fs::path& source,
+                    const fs::path& object, const fs::path& depfile,
+                    std::string& diagnostics, std::string& worker);
+
+// Serve preprocessed compile jobs
+int worker_main(int argc, char** argv);
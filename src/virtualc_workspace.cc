@@ -0,0 +1,302 @@
+#include "virtualc_workspace.h"
+#include "virtualc_install.h"
+#include "virtualc_lock.h"
+#include "virtualc_scheduler.h"
+#include <map>
+#include <mutex>
+#include <glob.h>
+
+// Workspace file listing the member projects of a monorepo
+const char* WORKSPACE_FILE_NAME = "vc-workspace.toml";
+
+// Directory under the workspace root holding the shared project every member resolves to
+const char* WORKSPACE_DIR_NAME = ".vc-workspace";
+
+namespace {
+
+struct WorkspaceConfig {
+    fs::path root;
+    std::vector<std::string> members;  // directories or glob patterns relative to root
+    std::string compiler;              // compilerpath used to build the shared packages
+};
+
+// One package of the union, and who asked for which version
+struct WorkspaceDependency {
+    std::map<std::string, std::vector<std::string>> requested_by;  // version -> members
+    std::vector<std::string> arguments;  // script arguments recorded in a member's lock
+    std::string version;                 // version the members pin, empty if none does
+};
+
+// Nearest directory from start upwards that holds a workspace file
+std::optional<fs::path> find_workspace_root(fs::path start) {
+    for (fs::path dir = fs::absolute(start); ; dir = dir.parent_path()) {
+        if (fs::exists(dir / WORKSPACE_FILE_NAME)) return dir;
+        if (dir == dir.root_path()) return std::nullopt;
+    }
+}
+
+std::optional<WorkspaceConfig> read_workspace(const fs::path& root) {
+    WorkspaceConfig config;
+    config.root = root;
+    try {
+        auto tbl = toml::parse_file((root / WORKSPACE_FILE_NAME).string());
+        auto* workspace = tbl.get_as<toml::table>("workspace");
+        if (!workspace) {
+            std::cerr << "Error: " << WORKSPACE_FILE_NAME << " has no [workspace] table." << std::endl;
+            return std::nullopt;
+        }
+        if (auto* members = workspace->get_as<toml::array>("members")) {
+            for (auto& member : *members) {
+                if (auto str = member.value<std::string>()) config.members.push_back(*str);
+            }
+        }
+        if (auto node = workspace->get("compilerpath"); node && node->is_string()) {
+            config.compiler = node->value_or("");
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error parsing " << WORKSPACE_FILE_NAME << ": " << ex.what() << std::endl;
+        return std::nullopt;
+    }
+    return config;
+}
+
+// Member project directories: every match of the member patterns that has a cproject.toml
+std::vector<fs::path> expand_members(const WorkspaceConfig& config) {
+    std::set<fs::path> members;
+    for (const auto& pattern : config.members) {
+        glob_t matches;
+        if (glob((config.root / pattern).c_str(), GLOB_ONLYDIR, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                fs::path dir = fs::path(matches.gl_pathv[i]).lexically_normal();
+                if (fs::exists(dir / "cproject.toml")) members.insert(dir);
+            }
+        }
+        globfree(&matches);
+    }
+    return std::vector<fs::path>(members.begin(), members.end());
+}
+
+// The shared project the union is installed into; never the workspace root
+// itself, whose README and .gitignore belong to the monorepo
+void ensure_shared_project(const fs::path& shared, const std::string& compiler) {
+    fs::create_directories(shared / ".venv");
+    if (!fs::exists(shared / ".ignorepath")) create_file(shared / ".ignorepath", IGNOREPATH_CONTENT);
+    if (!fs::exists(shared / ".libpath")) write_file_atomic(shared / ".libpath", "");
+
+    toml::table tbl;
+    if (fs::exists(shared / "cproject.toml")) {
+        tbl = toml::parse_file((shared / "cproject.toml").string());
+    }
+    if (!tbl.get_as<toml::table>("project")) tbl.insert_or_assign("project", toml::table{});
+    auto& proj = *tbl.get_as<toml::table>("project");
+    if (!proj.get("dependencies")) proj.insert_or_assign("dependencies", toml::array{});
+    proj.insert_or_assign("compilerpath", compiler);
+
+    std::ostringstream out;
+    out << tbl;
+    if (read_file(shared / "cproject.toml") != out.str()) write_file_atomic(shared / "cproject.toml", out.str());
+}
+
+// Registered in the shared .libpath with its directories still on disk
+bool is_shared_package_intact(const std::map<std::string, LibpathEntry>& shared, const std::string& name) {
+    auto it = shared.find(name);
+    if (it == shared.end()) return false;
+    std::error_code ec;
+    for (const auto& include : it->second.includes) {
+        if (!fs::is_directory(include, ec)) return false;
+    }
+    for (const auto& path : it->second.libpaths) {
+        if (!fs::is_directory(path, ec)) return false;
+    }
+    return true;
+}
+
+bool same_resolution(const LockEntry& a, const LockEntry& b) {
+    return a.version == b.version && a.source == b.source && a.prefix == b.prefix && a.includes == b.includes &&
+           a.libnames == b.libnames && a.libpaths == b.libpaths;
+}
+
+} // namespace
+
+// Implement workspace subcommand
+int workspace_main(int argc, char** argv) {
+    cxxopts::Options options("vc workspace", "Install the dependencies of every workspace member once and write their .libpath views");
+    options.add_options()
+        ("h,help", "Print usage")
+        ("j,jobs", "Number of packages to install concurrently", cxxopts::value<unsigned>()->default_value("0"))
+        ("prune", "Remove shared packages no member depends on any more");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    auto root = find_workspace_root(fs::current_path());
+    if (!root) {
+        std::cerr << "Error: No " << WORKSPACE_FILE_NAME << " in this directory or above." << std::endl;
+        return 1;
+    }
+    auto config = read_workspace(*root);
+    if (!config) return 1;
+    std::vector<fs::path> members = expand_members(*config);
+    if (members.empty()) {
+        std::cerr << "Error: No workspace member has a cproject.toml." << std::endl;
+        return 1;
+    }
+
+    // 1. Union of the members' dependencies; one version per package
+    std::map<std::string, WorkspaceDependency> dependencies;
+    std::map<fs::path, std::vector<std::string>> member_dependencies;
+    for (const auto& member : members) {
+        std::string name = member.lexically_relative(*root).string();
+        member_dependencies[member];
+        std::vector<LockEntry> locked = read_lockfile(member / "cproject.lock");
+        for (const auto& spec : get_dependency_specs(member / "cproject.toml")) {
+            size_t pos = spec.find("==");
+            std::string pkg = spec.substr(0, pos);
+            std::string version = pos == std::string::npos ? "" : spec.substr(pos + 2);
+            WorkspaceDependency& dep = dependencies[pkg];
+            dep.requested_by[version].push_back(name);
+            for (const auto& entry : locked) {
+                if (entry.name == pkg && entry.source == "script" && !entry.arguments.empty() && dep.arguments.empty() &&
+                    (version.empty() || entry.version == version)) {
+                    dep.arguments = entry.arguments;
+                }
+            }
+            member_dependencies[member].push_back(pkg);
+        }
+    }
+    bool conflict = false;
+    for (auto& [pkg, dep] : dependencies) {
+        size_t pinned = dep.requested_by.size() - dep.requested_by.count("");
+        if (pinned == 1) dep.version = dep.requested_by.rbegin()->first;
+        if (pinned <= 1) continue;
+        std::cerr << "Error: Members need different versions of '" << pkg << "':" << std::endl;
+        for (const auto& [version, names] : dep.requested_by) {
+            if (version.empty()) continue;
+            std::cerr << "  " << version << ":";
+            for (const auto& name : names) std::cerr << " " << name;
+            std::cerr << std::endl;
+        }
+        conflict = true;
+    }
+    if (conflict) return 1;
+
+    std::cout << "Workspace: " << members.size() << " members, " << dependencies.size() << " packages" << std::endl;
+
+    // 2. Install what the shared project is missing, each package once
+    fs::path shared = *root / WORKSPACE_DIR_NAME;
+    ensure_shared_project(shared, config->compiler);
+    fs::current_path(shared);
+    fs::path shared_libpath = shared / ".libpath";
+
+    std::map<std::string, LibpathEntry> installed;
+    for (auto& entry : read_libpath_entries(shared_libpath)) installed[entry.name] = entry;
+    for (const auto& entry : read_lockfile(shared / "cproject.lock")) {
+        auto it = dependencies.find(entry.name);
+        if (it != dependencies.end() && it->second.arguments.empty() && !entry.arguments.empty()) {
+            it->second.arguments = entry.arguments;
+        }
+    }
+    // The pin wins over whatever version a lock recorded; the script's other arguments are kept
+    for (auto& [pkg, dep] : dependencies) {
+        if (!dep.version.empty() && !dep.arguments.empty()) dep.arguments[0] = dep.version;
+    }
+
+    // Packages without recorded arguments may prompt, so they go first and one at a time
+    std::vector<std::string> interactive, batch;
+    for (const auto& [pkg, dep] : dependencies) {
+        bool pinned_version = dep.version.empty() || (installed.count(pkg) && installed[pkg].version == dep.version);
+        if (is_shared_package_intact(installed, pkg) && pinned_version) continue;
+        if (installed.count(pkg)) {
+            if (!pinned_version) {
+                std::cout << "Replacing " << pkg << " " << installed[pkg].version << " with the pinned " << dep.version << std::endl;
+            }
+            remove_package_from_libpath(shared_libpath, pkg);
+        }
+        (dep.arguments.empty() ? interactive : batch).push_back(pkg);
+    }
+    std::mutex failed_mutex;
+    std::vector<std::string> failed;
+    auto install = [&](const std::string& pkg) {
+        std::cout << "Installing package: " << pkg << std::endl;
+        const WorkspaceDependency& dep = dependencies.at(pkg);
+        if (!install_package(pkg, dep.arguments, dep.version)) {
+            std::lock_guard<std::mutex> guard(failed_mutex);
+            failed.push_back(pkg);
+        }
+    };
+    for (const auto& pkg : interactive) install(pkg);
+    parallel_for(batch.size(), [&](size_t i) { install(batch[i]); }, result["jobs"].as<unsigned>());
+    if (!interactive.empty() || !batch.empty()) print_install_report(InstallScheduler::instance().report());
+
+    if (result.count("prune")) {
+        for (const auto& [name, entry] : installed) {
+            if (dependencies.count(name)) continue;
+            std::cout << "Removing package no member depends on: " << name << std::endl;
+            remove_package_from_libpath(shared_libpath, name);
+            remove_dependency_toml(shared / "cproject.toml", name);
+            remove_lockfile_entry(shared / "cproject.lock", name);
+            std::error_code ec;
+            fs::remove_all(shared / ".venv" / name, ec);
+        }
+    }
+
+    // 3. Every member gets a .libpath and lock entries pointing into the shared prefix
+    installed.clear();
+    for (auto& entry : read_libpath_entries(shared_libpath)) installed[entry.name] = entry;
+    // pkg-config and scripts may resolve another version than asked for; members get no view of it
+    for (const auto& [pkg, dep] : dependencies) {
+        auto it = installed.find(pkg);
+        if (dep.version.empty() || it == installed.end() || it->second.version == dep.version) continue;
+        std::cerr << "Error: '" << pkg << "' resolved to version " << it->second.version << ", but members pin "
+                  << dep.version << "." << std::endl;
+        installed.erase(it);
+        failed.push_back(pkg);
+    }
+    std::map<std::string, LockEntry> shared_locked;
+    for (auto& entry : read_lockfile(shared / "cproject.lock")) shared_locked[entry.name] = entry;
+
+    size_t written = 0;
+    std::mutex written_mutex;
+    parallel_for(members.size(), [&](size_t i) {
+        const fs::path& member = members[i];
+        std::string view;
+        std::vector<LockEntry> lock_updates;
+        std::map<std::string, LockEntry> member_locked;
+        for (auto& entry : read_lockfile(member / "cproject.lock")) member_locked[entry.name] = entry;
+        for (const auto& pkg : member_dependencies.at(member)) {
+            auto it = installed.find(pkg);
+            if (it == installed.end()) continue;  // failed to install; reported below
+            view += libpath_section(it->second);
+            auto locked = shared_locked.find(pkg);
+            if (locked == shared_locked.end()) continue;
+            auto current = member_locked.find(pkg);
+            if (current == member_locked.end() || !same_resolution(current->second, locked->second)) {
+                lock_updates.push_back(locked->second);
+            }
+        }
+
+        // Unchanged views are left alone: .libpath is an input of every vc run up-to-date check
+        bool changed;
+        {
+            FileLock lock(project_lock_path(member));
+            changed = read_file(member / ".libpath") != view;
+            if (changed) write_file_atomic(member / ".libpath", view);
+        }
+        for (const auto& entry : lock_updates) update_lockfile_entry(member / "cproject.lock", entry);
+        if (changed) {
+            std::lock_guard<std::mutex> guard(written_mutex);
+            written++;
+        }
+    });
+
+    std::cout << "Workspace resolved: " << installed.size() << " shared packages, " << written
+              << " member .libpath files updated." << std::endl;
+    if (!failed.empty()) {
+        for (const auto& pkg : failed) std::cerr << "Failed to install '" << pkg << "'." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "virtualc_common.h"
+
+// Workspace file listing the member projects of a monorepo
+extern const char* WORKSPACE_FILE_NAME;
+
+// Directory under the workspace root holding the shared project every member resolves to
+extern const char* WORKSPACE_DIR_NAME;
+
+// Install the union of the members' dependencies once into the shared prefix
+// and write each member's .libpath view of it
+int workspace_main(int argc, char** argv);